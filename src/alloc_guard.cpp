@@ -0,0 +1,94 @@
+#include "alloc_guard.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stddef.h>
+
+static TaskHandle_t watched_task = nullptr;
+static uint32_t exempt_depth = 0; // only touched from the watched task
+static volatile uint32_t allocations = 0;
+static volatile uint32_t exempt_allocations = 0;
+
+static bool on_watched_task() {
+    return watched_task != nullptr && xTaskGetCurrentTaskHandle() == watched_task;
+}
+
+static void note_allocation() {
+    if (!on_watched_task()) {
+        return;
+    }
+    if (exempt_depth > 0) {
+        exempt_allocations = exempt_allocations + 1;
+    } else {
+        allocations = allocations + 1;
+    }
+}
+
+#if defined(ARDUINO)
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    note_allocation();
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    note_allocation();
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    note_allocation();
+    return __real_realloc(ptr, size);
+}
+}
+#else
+// Host build (glibc): the allocator is interposed instead of wrapped.
+// operator new lands here as well, since libstdc++ builds it on malloc.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) noexcept {
+    note_allocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    note_allocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    note_allocation();
+    return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+void AllocGuard::watch_current_task() {
+    watched_task = xTaskGetCurrentTaskHandle();
+}
+
+uint32_t AllocGuard::count() {
+    return allocations;
+}
+
+uint32_t AllocGuard::exempt_count() {
+    return exempt_allocations;
+}
+
+AllocExempt::AllocExempt() : active(on_watched_task()) {
+    if (active) {
+        exempt_depth++;
+    }
+}
+
+AllocExempt::~AllocExempt() {
+    if (active) {
+        exempt_depth--;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+// Counts heap allocations made on the main loop task, so the steady-state
+// paths (polling, input, display, taps) can be held to zero. malloc, calloc
+// and realloc are wrapped at link time (see build_flags in platformio.ini);
+// the host build interposes them instead.
+// Allocations inside an AllocExempt scope are counted apart: they belong to
+// libraries that allocate on open (the SD filesystem, the decoder).
+class AllocGuard {
+public:
+    // Starts counting on the calling task.
+    static void watch_current_task();
+    static uint32_t count();
+    static uint32_t exempt_count();
+};
+
+class AllocExempt {
+private:
+    bool active;
+
+public:
+    AllocExempt();
+    ~AllocExempt();
+    AllocExempt(const AllocExempt&) = delete;
+    AllocExempt& operator=(const AllocExempt&) = delete;
+};
@@ -1,10 +1,26 @@
 #include "app.h"
+#include "alloc_guard.h"
 #include "config_manager.h"
 #include "debug.h"
-#include <SD.h>
+#include "storage_fs.h"
+#include <driver/i2s.h>
 
 App::App(DisplayManager& display_mgr) 
-    : state(APP_STATE_IDLE), volume_level(0), display_manager(display_mgr) {}
+    : config_loaded(false), config_loading(false), state(APP_STATE_IDLE), active_card(nullptr), resume_offset(0),
+      audio_read_pos(0), next_index_card(0), volume_level(0), volume_adjusted(false),
+      display_manager(display_mgr), sfx_pump_offset(0), sfx_pump_length(0),
+      sfx_pump_tail(false) {
+    dsp.add(&eq_stage);
+    dsp.add(&volume_stage);
+    dsp.add(&limiter_stage);
+    sfx_bank.set_gain(SFX_GAIN);
+
+    // Sized once so filling it in on a tap reuses the same buffers.
+    ndef_card.id.reserve(UidString::capacity());
+    ndef_card.file.reserve(PathString::capacity());
+    ndef_card.name.reserve(PathString::capacity());
+    ndef_card.has_photo = false;
+}
 
 bool App::is_playing() const { 
     return state == APP_STATE_PLAYING; 
@@ -19,82 +35,330 @@ bool App::is_idle() const {
 }
 
 void App::set_state(AppState new_state) { 
+    if (new_state != state) {
+        debug_print("State: %d -> %d", (int)state, (int)new_state);
+    }
     state = new_state; 
 }
 
+AppState App::get_state() const {
+    return state;
+}
+
 void App::set_volume(int val) {
     volume_level = val;
-    audio.setVolume(volume_level);
+    volume_stage.set_level(volume_level);
+}
+
+void App::apply_eq(const Config& conf) {
+    eq_stage.set_gain(EQ_BASS, conf.eq_bass_db);
+    eq_stage.set_gain(EQ_MID, conf.eq_mid_db);
+    eq_stage.set_gain(EQ_TREBLE, conf.eq_treble_db);
 }
 
-std::optional<Card> App::find_card_by_uid(const String& uid) {
+const char* App::audiodb_path() const {
+    return config ? config.value().audiodb_path.c_str() : DEFAULT_AUDIODB_PATH;
+}
+
+const Card* App::find_card_by_uid(const char* uid) const {
+    if (!config) {
+        return nullptr;
+    }
     for (const auto& card : config.value().cards) {
         if (card.id == uid) {
-            return card;
+            return &card;
         }
     }
-    return std::nullopt;
+    return nullptr;
 }
 
-void App::play_card(const std::optional<Card>& card) {
-    String audio_db_path = config.value().audiodb_path;
+const Card* App::card_from_ndef(const char* card_uid, const char* ndef_path) {
+    PathString path = ConfigManager::resolve_path(audiodb_path(), ndef_path);
+    if (path.truncated() || !sd_storage.exists(path.c_str(), STORAGE_AUDIO)) {
+        debug_print("NDEF track not found: %s", path.c_str());
+        return nullptr;
+    }
 
-    if (!card.has_value()) {
-        String fallback = audio_db_path + "/" + config.value().unknown_card_sfx;
-        display_manager.draw_centered_bitmap(fallback + ".bmp");
-        audio.connecttoFS(SD, fallback.c_str());
-        return;
+    PathString bmp_path = path;
+    bmp_path += ".bmp";
+    ndef_card.id = card_uid;
+    ndef_card.file = ndef_path;
+    ndef_card.name = ndef_path;
+    ndef_card.has_photo = sd_storage.exists(bmp_path.c_str(), STORAGE_ARTWORK);
+    return &ndef_card;
+}
+
+void App::load_sfx(const Config& conf) {
+    if (conf.unknown_card_sfx.endsWith(".wav")) {
+        sfx_bank.load(SFX_UNKNOWN_CARD, sd_storage,
+                      ConfigManager::resolve_path(conf.audiodb_path.c_str(), conf.unknown_card_sfx.c_str()).c_str());
+    }
+    if (!conf.click_sfx.isEmpty()) {
+        sfx_bank.load(SFX_CLICK, sd_storage,
+                      ConfigManager::resolve_path(conf.audiodb_path.c_str(), conf.click_sfx.c_str()).c_str());
+    }
+}
+
+bool App::trigger_sfx(SfxId id) {
+    if (!config) {
+        return false; // the bank may still be loading
+    }
+    if (is_idle()) {
+        // Nothing owns the I2S clock, so run it at a fixed rate for the effects.
+        i2s_set_sample_rates(I2S_NUM_0, SFX_IDLE_RATE);
+        sfx_bank.set_output_rate(SFX_IDLE_RATE);
+        dsp.set_sample_rate(SFX_IDLE_RATE);
     }
+    return sfx_bank.play(id);
+}
 
-    String path = audio_db_path + "/" + card.value().file;
-    if (!SD.exists(path)) {
-        debug_print("Audio file not found: %s", path.c_str());
-        String fallback = audio_db_path + "/" + config.value().unknown_card_sfx;
-        audio.connecttoFS(SD, fallback.c_str());
+void App::play_unknown_card_sfx() {
+    if (trigger_sfx(SFX_UNKNOWN_CARD)) {
+        debug_print("Unknown card effect playing");
+        return;
+    }
+    if (!config) {
         return;
     }
+    // Not preloaded (e.g. an MP3): stream it, replacing whatever was playing.
+    PathString fallback = ConfigManager::resolve_path(audiodb_path(), config.value().unknown_card_sfx.c_str());
+    Storage::account(STORAGE_SFX, 0, 1, 0);
+    AllocExempt decoder_open;
+    if (audio.connecttoFS(sd_storage.filesystem(), fallback.c_str())) {
+        dsp.reset();
+    }
+}
 
+void App::pump_idle_sfx() {
     if (is_playing()) {
+        // The decoder carries effects through process_output().
+        sfx_pump_offset = sfx_pump_length = 0;
+        sfx_pump_tail = false;
+        return;
+    }
+
+    while (true) {
+        if (sfx_pump_offset == sfx_pump_length) {
+            size_t frames = sfx_bank.render(sfx_pump_buffer, SFX_PUMP_FRAMES);
+            if (frames == 0 && !sfx_pump_tail) {
+                return;
+            }
+            // Pad the tail with silence so the limiter only ever sees full blocks.
+            // Once the effects run out, one block of silence pushes the last
+            // one out of the limiter's look-ahead, so the next starts clean.
+            sfx_pump_tail = frames > 0;
+            size_t padded = frames == 0 ? DSP_BLOCK_FRAMES
+                                        : (frames + DSP_BLOCK_FRAMES - 1) / DSP_BLOCK_FRAMES * DSP_BLOCK_FRAMES;
+            memset(sfx_pump_buffer + frames * 2, 0, (padded - frames) * 2 * sizeof(int16_t));
+            frames = padded;
+            dsp.process(sfx_pump_buffer, frames);
+            sfx_pump_offset = 0;
+            sfx_pump_length = frames * 2 * sizeof(int16_t);
+        }
+
+        size_t written = 0;
+        i2s_write(I2S_NUM_0, (const uint8_t*)sfx_pump_buffer + sfx_pump_offset,
+                  sfx_pump_length - sfx_pump_offset, &written, 0);
+        if (written == 0) {
+            return; // DMA buffers are full, try again next loop
+        }
+        sfx_pump_offset += written;
+    }
+}
+
+void App::play_card(const Card* card) {
+    if (!card) {
+        play_unknown_card_sfx();
+        if (config) {
+            PathString bmp_path = ConfigManager::resolve_path(audiodb_path(), config.value().unknown_card_sfx.c_str());
+            bmp_path += ".bmp";
+            display_manager.draw_centered_bitmap(bmp_path.c_str());
+        }
+        return;
+    }
+
+    PathString path = ConfigManager::resolve_path(audiodb_path(), card->file.c_str());
+
+    if (!is_idle()) { // paused too: the decoder still holds the old track
+        account_audio_reads();
         audio.stopSong();
+        monitor.stop();
+    }
+
+    // The decoder allocates its buffers and file handle on connect; that is
+    // outside the steady-state budget.
+    bool connected;
+    {
+        AllocExempt decoder_open;
+        // No existence check first: a missing file simply fails to connect, so
+        // the track is only opened once.
+        Storage::account(STORAGE_AUDIO, 0, 1, 0);
+        connected = audio.connecttoFS(sd_storage.filesystem(), path.c_str());
     }
 
-    if (audio.connecttoFS(SD, path.c_str())) {
+    if (connected) {
+        dsp.reset(); // nothing of the last track left in the look-ahead
+        monitor.start(audio.inBufferFilled() + audio.inBufferFree());
         active_card = card;
-        if (active_card.value().has_photo) {
-            String active_card_bmp_path = ConfigManager::get_card_bmp_path(config.value(), card.value());
-            display_manager.draw_centered_bitmap(active_card_bmp_path);
+        active_path = path;
+        resume_offset = 0;
+        audio_read_pos = 0;
+        if (!seek_index.load(sd_storage, path.c_str(), audio.getFileSize()) && path.ends_with(".mp3")) {
+            index_pending = path;
+        }
+        if (card->has_photo) {
+            PathString bmp_path = path;
+            bmp_path += ".bmp";
+            display_manager.draw_centered_bitmap(bmp_path.c_str());
         }
         set_state(APP_STATE_PLAYING);
         debug_print("Audio started successfully");
     } else {
         set_state(APP_STATE_IDLE);
-        active_card.reset();
+        active_card = nullptr;
+        seek_index.clear();
         display_manager.reset();
-        debug_print("Failed to start audio");
+        debug_print("Failed to start audio: %s", path.c_str());
+        play_unknown_card_sfx();
     }
 }
 
-void App::setup() {
-    config = ConfigManager::load_config(CONF_PATH);
+// The decoder reads its file itself, so its I/O is counted from how far the
+// file position has moved.
+void App::account_audio_reads() {
+    uint32_t pos = audio.getFilePos();
+    if (pos > audio_read_pos) {
+        Storage::account(STORAGE_AUDIO, pos - audio_read_pos, 0, 0);
+    }
+    audio_read_pos = pos;
+}
+
+bool App::start_next_index() {
+    if (!index_pending.empty()) {
+        PathString path = index_pending;
+        index_pending.clear();
+        return index_builder.begin(sd_storage, path.c_str());
+    }
+    if (!config || next_index_card >= config.value().cards.size()) {
+        return false;
+    }
+
+    const Card& card = config.value().cards[next_index_card++];
+    PathString path = ConfigManager::resolve_path(audiodb_path(), card.file.c_str());
+    if (!path.ends_with(".mp3") || sd_storage.exists(SeekIndex::sidecar_path(path.c_str()).c_str(), STORAGE_INDEX)) {
+        return false;
+    }
+    return index_builder.begin(sd_storage, path.c_str());
+}
+
+// Seek indexes are built in small slices whenever nothing is playing: the
+// active track first, then every card in the config that lacks one.
+void App::build_seek_indexes() {
+    if (is_playing()) {
+        return;
+    }
+    if (!index_builder.is_active() && !start_next_index()) {
+        return;
+    }
+    if (index_builder.step(INDEX_STEP_BYTES) && active_card && index_builder.track() == active_path) {
+        seek_index.load(sd_storage, active_path.c_str());
+    }
+}
+
+void App::config_loader_task(void* param) {
+    App* app = static_cast<App*>(param);
+    unsigned long start = millis();
+
+    app->loaded_config = ConfigManager::load_config(CONF_PATH);
+    if (app->loaded_config) {
+        debug_print("Config parsed in %lu ms", millis() - start);
+        ConfigManager::index_artwork(app->loaded_config.value());
+        debug_print("Artwork indexed in %lu ms", millis() - start);
+        app->load_sfx(app->loaded_config.value());
+        debug_print("SFX loaded in %lu ms", millis() - start);
+    }
+
+    app->config_loaded = true;
+    vTaskDelete(nullptr);
+}
+
+void App::adopt_loaded_config() {
+    config_loading = false;
+    config = std::move(loaded_config);
+    loaded_config.reset();
 
+    // Cards carrying their own track path still play without a config.
     if (!config) {
         debug_print("Failed to load config!");
-        return;
+    } else {
+        debug_print("Config loaded successfully");
+        // The encoder works while the config loads; don't undo a turn made then.
+        if (!volume_adjusted) {
+            set_volume(config.value().default_volume);
+        }
+        apply_eq(config.value());
     }
-    debug_print("Config loaded successfully");
 
+    if (!pending_uid.empty()) {
+        UidString uid = pending_uid;
+        pending_uid.clear();
+        play(uid.c_str());
+    }
+}
+
+void App::setup() {
     audio.setPinout(I2S_BCLK, I2S_LRCLK, I2S_DOUT);
-    set_volume(config.value().default_volume);
+    audio.setVolume(MAX_VOLUME);
+    set_volume(DEFAULT_VOLUME);
+
+    // The decoder creates its input buffer on the first connect and refuses
+    // to resize it after that, so the size the monitor settled on last boot
+    // goes in now.
+    uint32_t buffer_size = monitor.restore(sd_storage);
+    if (buffer_size > 0 && !audio.setBufsize(buffer_size, buffer_size)) {
+        monitor.resize_failed();
+    }
+
+    config_loading = true;
+    xTaskCreatePinnedToCore(config_loader_task, "config_loader", 8192, this, 1, nullptr, 0);
 }
 
 void App::loop() {
+    if (config_loading && config_loaded) {
+        adopt_loaded_config();
+    }
+
+    unsigned long loop_start = micros();
     audio.loop();
+    if (is_playing()) {
+        monitor.on_loop(micros() - loop_start, audio.inBufferFilled(), audio.inBufferFree(),
+                        audio.getSampleRate());
+        account_audio_reads();
+        sfx_bank.set_output_rate(audio.getSampleRate());
+        dsp.set_sample_rate(audio.getSampleRate());
+    }
+    pump_idle_sfx();
+    build_seek_indexes();
 }
 
-void App::play(const String& card_uid) {
-    std::optional<Card> card = find_card_by_uid(card_uid);
-    if (!card.has_value()) {
-        debug_print("No audio entry found with id %s", card_uid.c_str());
+void App::play(const char* card_uid, const char* ndef_path) {
+    if (ndef_path[0] != '\0') {
+        const Card* card = card_from_ndef(card_uid, ndef_path);
+        if (card) {
+            play_card(card);
+            return;
+        }
+    }
+
+    if (config_loading) {
+        debug_print("Config still loading, holding card %s", card_uid);
+        pending_uid = card_uid;
+        return;
+    }
+
+    const Card* card = find_card_by_uid(card_uid);
+    if (!card) {
+        debug_print("No audio entry found with id %s", card_uid);
     }
     play_card(card);
 }
@@ -102,6 +366,7 @@ void App::play(const String& card_uid) {
 void App::toggle_play_pause() {
     if (is_paused()) {
         audio.pauseResume();
+        monitor.resync();
         set_state(APP_STATE_PLAYING);
         debug_print("Audio resumed");
     } else if (is_playing()) {
@@ -109,24 +374,32 @@ void App::toggle_play_pause() {
         set_state(APP_STATE_PAUSED);
         debug_print("Audio paused");
     } else {
-        if (active_card.has_value()) {
-            play_card(active_card.value());
+        if (active_card) {
+            uint32_t offset = resume_offset;
+            play_card(active_card);
+            if (offset > 0 && is_playing() && audio.setFilePos(offset)) {
+                debug_print("Resumed at byte %u", offset);
+            }
         }
     }
 }
 
 void App::incr_volume() {
+    volume_adjusted = true;
     if (volume_level == MAX_VOLUME) {
         return;
     }
     set_volume(volume_level + 1);
+    trigger_sfx(SFX_CLICK);
 }
 
 void App::decr_volume() {
+    volume_adjusted = true;
     if (volume_level == MIN_VOLUME) {
         return;
     }
     set_volume(volume_level - 1);
+    trigger_sfx(SFX_CLICK);
 }
 
 void App::stop() {
@@ -134,29 +407,117 @@ void App::stop() {
         debug_print("No audio is currently playing");
         return;
     }
+    account_audio_reads();
+    resume_offset = played_file_pos();
     audio.stopSong();
+    monitor.stop();
+    dsp.reset();
     set_state(APP_STATE_IDLE);
     display_manager.reset();
     debug_print("Audio stopped");
 }
 
+// The decoder's file position runs ahead of what is being heard by whatever
+// sits in its input buffer.
+uint32_t App::played_file_pos() {
+    uint32_t pos = audio.getFilePos();
+    uint32_t buffered = audio.inBufferFilled();
+    return pos > buffered ? pos - buffered : 0;
+}
+
+uint32_t App::current_position() {
+    if (seek_index.is_loaded()) {
+        return seek_index.seconds_at(played_file_pos());
+    }
+    return audio.getAudioCurrentTime();
+}
+
+bool App::seek_to(uint32_t seconds) {
+    if (is_idle()) {
+        return false;
+    }
+
+    account_audio_reads();
+    bool ok;
+    if (seek_index.is_loaded()) {
+        seconds = min(seconds, seek_index.duration());
+        ok = audio.setFilePos(seek_index.offset_for(seconds));
+    } else {
+        ok = audio.setAudioPlayPosition(seconds);
+    }
+    audio_read_pos = audio.getFilePos();
+    monitor.resync();
+    dsp.reset();
+    debug_print("Seek to %u s (%s): %s", seconds, seek_index.is_loaded() ? "indexed" : "estimated",
+                ok ? "ok" : "failed");
+    return ok;
+}
+
+void App::seek_by(int seconds) {
+    int target = (int)current_position() + seconds;
+    seek_to(max(target, 0));
+}
+
 void App::show_info() {
     debug_print("=== Current Status ===");
     debug_print("Current volume: %d", volume_level);
     debug_print("Current state: %d", (int)state);
 
-    if (auto active_card_ref = active_card; active_card_ref.has_value()) {
+    if (active_card) {
         debug_print("Active card: %s (%s)", 
-                   active_card_ref.value().name.c_str(), 
-                   active_card_ref.value().id.c_str());
+                   active_card->name.c_str(), 
+                   active_card->id.c_str());
+        debug_print("Position: %u s%s", current_position(), seek_index.is_loaded() ? "" : " (no seek index)");
     } else {
         debug_print("No active card");
     }
+    monitor.report();
+
+    debug_print("=== Storage ===");
+    for (int i = 0; i < STORAGE_CONSUMERS; i++) {
+        StorageConsumer consumer = (StorageConsumer)i;
+        StorageStats stats = Storage::stats(consumer);
+        if (stats.busy_us > 0) {
+            debug_print("  %-8s %u bytes, %u calls, %u KB/s", Storage::consumer_name(consumer), stats.bytes,
+                        stats.calls, (uint32_t)((uint64_t)stats.bytes * 1000000 / 1024 / stats.busy_us));
+        } else {
+            debug_print("  %-8s %u bytes, %u calls", Storage::consumer_name(consumer), stats.bytes, stats.calls);
+        }
+    }
 }
 
 void App::on_song_finished() {
+    monitor.stop();
+    dsp.reset();
     set_state(APP_STATE_IDLE);
-    active_card.reset();
+    active_card = nullptr;
+    seek_index.clear();
     display_manager.reset();
     debug_print("Song finished - state set to idle");
+}
+
+void App::process_output(int16_t* frame) {
+    monitor.on_frame();
+    sfx_bank.mix(frame);
+    dsp.process_frame(frame);
+}
+
+static uint32_t cycle_count() {
+    return ESP.getCycleCount();
+}
+
+void App::run_dsp_benchmark() {
+    DspBenchmark results[8];
+    size_t count = dsp_benchmark(cycle_count, results, 8);
+
+    debug_print("=== DSP benchmark (%d frames per block) ===", (int)DSP_BLOCK_FRAMES);
+    for (size_t i = 0; i < count; i++) {
+        debug_print("  %-14s %u.%02u cycles/sample", results[i].name,
+                    results[i].cycles_per_sample_x100 / 100, results[i].cycles_per_sample_x100 % 100);
+    }
+
+    uint32_t samples = 0;
+    uint32_t mismatches = dsp_compare_gain_kernels(&samples);
+    debug_print("  gain vs scalar reference: %u of %u samples differ%s", mismatches, samples,
+                mismatches == 0 ? "" : " - MISMATCH");
 }
\ No newline at end of file
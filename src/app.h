@@ -1,8 +1,14 @@
 #pragma once
 
+#include "audio_monitor.h"
 #include "config.h"
 #include "display_manager.h"
+#include "dsp.h"
+#include "fixed_string.h"
+#include "seek_index.h"
+#include "sfx_bank.h"
 #include <Audio.h>
+#include <atomic>
 #include <optional>
 
 enum AppState {
@@ -15,32 +21,94 @@ class App {
 private:
     static const int MIN_VOLUME = 0;
     static const int MAX_VOLUME = 21;
+    static const int DEFAULT_VOLUME = 10;
+    static const uint32_t SFX_IDLE_RATE = 44100;
+    static constexpr const char* DEFAULT_AUDIODB_PATH = "/audiodb";
+    static const size_t INDEX_STEP_BYTES = 8192; // scanned per idle loop
+    static const size_t SFX_PUMP_FRAMES = 128; // a multiple of DSP_BLOCK_FRAMES
+    static const int32_t SFX_GAIN = 23197;     // Q15, -3 dB under the music
 
     std::optional<Config> config;
+    // Filled in by the background loader, then adopted by loop().
+    std::optional<Config> loaded_config;
+    std::atomic<bool> config_loaded;
+    bool config_loading;
+    UidString pending_uid; // tapped before the config was in
     AppState state;
     Audio audio;
-    std::optional<Card> active_card;
+    const Card* active_card; // into the config's cards, or ndef_card
+    Card ndef_card;          // built from a card carrying its own path
+    PathString active_path;
+    uint32_t resume_offset; // byte offset the active card was stopped at
+    uint32_t audio_read_pos; // decoder file position already counted in the storage stats
+    SeekIndex seek_index;   // of the active track
+    SeekIndexBuilder index_builder;
+    PathString index_pending; // active track still lacking a seek index
+    size_t next_index_card;
     int volume_level;
-    DisplayManager display_manager;
+    bool volume_adjusted; // by the user since boot; the config default then no longer applies
+    DisplayManager& display_manager;
+    SfxBank sfx_bank;
+    AudioMonitor monitor;
+
+    // Everything headed for I2S passes through here: EQ, then volume (the
+    // decoder itself runs at full volume), then the limiter.
+    EqStage eq_stage;
+    VolumeStage volume_stage;
+    LimiterStage limiter_stage;
+    DspChain dsp;
+
+    // Effects rendered while no stream is feeding I2S, waiting to be written out.
+    int16_t sfx_pump_buffer[SFX_PUMP_FRAMES * 2];
+    size_t sfx_pump_offset;
+    size_t sfx_pump_length;
+    bool sfx_pump_tail; // the limiter's look-ahead still holds the end of the last effect
 
     bool is_playing() const;
     bool is_paused() const;
     bool is_idle() const;
     void set_state(AppState new_state);
     void set_volume(int val);
-    std::optional<Card> find_card_by_uid(const String& uid);
-    void play_card(const std::optional<Card>& card);
+    void apply_eq(const Config& conf);
+    static void config_loader_task(void* param);
+    void adopt_loaded_config();
+    const char* audiodb_path() const;
+    const Card* find_card_by_uid(const char* uid) const;
+    const Card* card_from_ndef(const char* card_uid, const char* ndef_path);
+    void play_card(const Card* card);
+    void account_audio_reads();
+    uint32_t played_file_pos();
+    void load_sfx(const Config& conf);
+    bool trigger_sfx(SfxId id);
+    void play_unknown_card_sfx();
+    void pump_idle_sfx();
+    bool start_next_index();
+    void build_seek_indexes();
 
 public:
     App(DisplayManager& display_mgr);
     
+    // Returns right away; the config, artwork index and sound effects are loaded
+    // in the background.
     void setup();
     void loop();
-    void play(const String& card_uid);
+    // Plays the track whose path is stored on the card, falling back to looking
+    // the UID up in the config.
+    void play(const char* card_uid, const char* ndef_path = "");
     void toggle_play_pause();
     void incr_volume();
     void decr_volume();
     void stop();
+    // Seeking uses the track's seek index when it has one, and falls back to the
+    // decoder's bitrate-based estimate otherwise.
+    uint32_t current_position();
+    bool seek_to(uint32_t seconds);
+    void seek_by(int seconds);
     void show_info();
+    void run_dsp_benchmark();
     void on_song_finished();
+    AppState get_state() const;
+    // Called by the decoder for every stereo frame on its way to I2S. Frames
+    // come out of the DSP chain one block later.
+    void process_output(int16_t* frame);
 };
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "audio_monitor.h"
+#include "debug.h"
+
+RollingStats::RollingStats() {
+    reset();
+}
+
+void RollingStats::add(uint32_t value) {
+    samples[next] = value;
+    next = (next + 1) % WINDOW;
+    if (count < WINDOW) {
+        count++;
+    }
+}
+
+void RollingStats::reset() {
+    count = 0;
+    next = 0;
+}
+
+size_t RollingStats::size() const {
+    return count;
+}
+
+uint32_t RollingStats::lowest() const {
+    uint32_t result = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        result = std::min(result, samples[i]);
+    }
+    return count ? result : 0;
+}
+
+uint32_t RollingStats::highest() const {
+    uint32_t result = 0;
+    for (size_t i = 0; i < count; i++) {
+        result = std::max(result, samples[i]);
+    }
+    return result;
+}
+
+uint32_t RollingStats::mean() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    return count ? total / count : 0;
+}
+
+uint32_t RollingStats::recent(size_t age) const {
+    return samples[(next + WINDOW - 1 - age) % WINDOW];
+}
+
+AudioMonitor::AudioMonitor()
+    : interval_start(0), interval_min_fill(100), interval_loop_us(0), interval_frames(0),
+      pending_frames(0), queued_frames(0), last_drain_us(0), starved(false), underruns(0),
+      underruns_total(0), buffer_size(0), next_buffer_size(0), saved_buffer_size(0), resizable(true),
+      storage(nullptr) {}
+
+uint32_t AudioMonitor::restore(Storage& target) {
+    storage = &target;
+    StorageFile file = storage->open(STATE_PATH, STORAGE_CONFIG);
+    uint32_t state[2];
+    if (!file || file.read(state, sizeof(state)) != sizeof(state) || state[0] != STATE_MAGIC ||
+        state[1] < MIN_BUFFER_SIZE || state[1] > max_buffer_size()) {
+        return 0;
+    }
+    saved_buffer_size = next_buffer_size = state[1];
+    return state[1];
+}
+
+void AudioMonitor::save() {
+    if (!storage || next_buffer_size == 0 || next_buffer_size == saved_buffer_size) {
+        return;
+    }
+    StorageFile file = storage->open(STATE_PATH, STORAGE_CONFIG, true);
+    uint32_t state[2] = {STATE_MAGIC, next_buffer_size};
+    if (file && file.write(state, sizeof(state)) == sizeof(state) && file.close()) {
+        saved_buffer_size = next_buffer_size;
+        debug_print("Audio: input buffer of %u bytes takes effect from the next boot", next_buffer_size);
+    } else {
+        debug_print("Audio: cannot save the input buffer size to %s", STATE_PATH);
+    }
+}
+
+uint32_t AudioMonitor::max_buffer_size() const {
+    return psramFound() ? MAX_BUFFER_SIZE_PSRAM : MAX_BUFFER_SIZE_RAM;
+}
+
+void AudioMonitor::start(uint32_t current_buffer_size) {
+    fill_percent.reset();
+    loop_time.reset();
+    interval_start = millis();
+    interval_min_fill = 100;
+    interval_loop_us = 0;
+    interval_frames = 0;
+    resync();
+    underruns = 0;
+    buffer_size = current_buffer_size;
+    if (next_buffer_size == 0) {
+        next_buffer_size = current_buffer_size;
+    }
+}
+
+void AudioMonitor::resize_failed() {
+    if (resizable) {
+        debug_print("Audio: decoder refused a %u byte input buffer, no longer adapting", next_buffer_size);
+    }
+    resizable = false;
+}
+
+void AudioMonitor::resync() {
+    pending_frames = 0;
+    queued_frames = 0;
+    last_drain_us = micros();
+    starved = true;
+}
+
+void AudioMonitor::stop() {
+    if (underruns > 0) {
+        debug_print("Audio: %u underruns this track", underruns);
+    }
+    save();
+}
+
+void AudioMonitor::on_frame() {
+    pending_frames++;
+}
+
+void AudioMonitor::on_loop(uint32_t loop_us, uint32_t in_filled, uint32_t in_free, uint32_t sample_rate) {
+    uint32_t frames = pending_frames;
+    pending_frames = 0;
+
+    unsigned long now_us = micros();
+    uint32_t drained = (uint64_t)(now_us - last_drain_us) * sample_rate / 1000000;
+    if (drained > 0) {
+        last_drain_us = now_us;
+    }
+
+    // Count the moment the queue runs dry, not every loop it stays dry; the
+    // queue starts out "starved" so priming it is not an underrun.
+    if (queued_frames + frames <= drained) {
+        if (!starved) {
+            underruns++;
+            underruns_total++;
+            debug_print("Audio: I2S underrun #%u (input buffer %u bytes filled)", underruns_total, in_filled);
+        }
+        starved = true;
+        queued_frames = 0;
+    } else {
+        queued_frames += frames - drained;
+        if (queued_frames > I2S_DMA_FRAMES) {
+            queued_frames = I2S_DMA_FRAMES; // the decoder blocks on a full queue
+        }
+        starved = false;
+    }
+
+    uint32_t in_size = in_filled + in_free;
+    uint32_t fill = in_size ? (uint64_t)in_filled * 100 / in_size : 0;
+    interval_min_fill = std::min(interval_min_fill, fill);
+    interval_loop_us += loop_us;
+    interval_frames += frames;
+
+    if (millis() - interval_start >= SAMPLE_INTERVAL) {
+        sample();
+    }
+}
+
+void AudioMonitor::sample() {
+    fill_percent.add(interval_min_fill);
+    if (interval_frames > 0) {
+        loop_time.add((uint64_t)interval_loop_us * SAMPLES_PER_DECODE_FRAME / interval_frames);
+    }
+    interval_start = millis();
+    interval_min_fill = 100;
+    interval_loop_us = 0;
+    interval_frames = 0;
+    adapt();
+}
+
+void AudioMonitor::adapt() {
+    if (!resizable) {
+        return;
+    }
+    bool psram = psramFound();
+    bool memory_tight = psram ? ESP.getFreePsram() < LOW_PSRAM : ESP.getFreeHeap() < LOW_HEAP;
+
+    if (memory_tight) {
+        uint32_t size = next_buffer_size * 3 / 4;
+        if (size < MIN_BUFFER_SIZE) {
+            size = MIN_BUFFER_SIZE;
+        }
+        if (size < next_buffer_size) {
+            debug_print("Audio: memory tight, shrinking input buffer to %u bytes from the next boot", size);
+            next_buffer_size = size;
+        }
+        return;
+    }
+
+    if (fill_percent.size() < LOW_FILL_STREAK || next_buffer_size > buffer_size) {
+        return; // not enough to go on, or a bigger buffer is already waiting for the next boot
+    }
+    for (size_t i = 0; i < LOW_FILL_STREAK; i++) {
+        if (fill_percent.recent(i) >= LOW_FILL_PERCENT) {
+            return;
+        }
+    }
+
+    uint32_t size = std::min(buffer_size * 3 / 2, max_buffer_size());
+    if (size > next_buffer_size) {
+        debug_print("Audio: input buffer keeps running low, growing to %u bytes from the next boot", size);
+        next_buffer_size = size;
+    }
+}
+
+uint32_t AudioMonitor::recommended_buffer_size() const {
+    return next_buffer_size;
+}
+
+void AudioMonitor::report() const {
+    debug_print("Input buffer fill %%: min=%u avg=%u max=%u (size %u, next boot %u)", fill_percent.lowest(),
+                fill_percent.mean(), fill_percent.highest(), buffer_size, next_buffer_size);
+    debug_print("Audio loop us/frame (decode + SD reads): min=%u avg=%u max=%u", loop_time.lowest(),
+                loop_time.mean(), loop_time.highest());
+    debug_print("I2S underruns: %u this track, %u total", underruns, underruns_total);
+}
\ No newline at end of file
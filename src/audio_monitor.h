@@ -0,0 +1,109 @@
+#pragma once
+
+#include "storage.h"
+#include <Arduino.h>
+
+// Min/avg/max over the last WINDOW samples.
+class RollingStats {
+private:
+    static const size_t WINDOW = 32;
+
+    uint32_t samples[WINDOW];
+    size_t count;
+    size_t next;
+
+public:
+    RollingStats();
+
+    void add(uint32_t value);
+    void reset();
+    size_t size() const;
+    uint32_t lowest() const;
+    uint32_t highest() const;
+    uint32_t mean() const;
+    // Newest sample first.
+    uint32_t recent(size_t age) const;
+};
+
+// Watches the decoder's health while a track plays: input buffer fill, time
+// spent in the decoder loop, and I2S underruns. From that it picks the input
+// buffer size, growing it when the fill keeps dipping (slow SD, high bitrates)
+// and shrinking it when memory runs low. The decoder only takes a new size
+// before its first track, so the choice is saved to SD at the end of a track
+// and applied at the next boot.
+class AudioMonitor {
+private:
+    static const unsigned long SAMPLE_INTERVAL = 250;      // ms per window sample
+    static const uint32_t SAMPLES_PER_DECODE_FRAME = 1152; // MP3 (MPEG-1 layer III)
+
+    // The decoder installs its I2S driver with 16 DMA buffers of 512 frames;
+    // that's how much output can be queued ahead of the DAC.
+    static const uint32_t I2S_DMA_FRAMES = 16 * 512;
+
+    static const uint8_t LOW_FILL_PERCENT = 25;
+    static const size_t LOW_FILL_STREAK = 8; // samples in a row, ~2 s
+    static const uint32_t MIN_BUFFER_SIZE = 8 * 1024;
+    static const uint32_t MAX_BUFFER_SIZE_RAM = 64 * 1024;
+    static const uint32_t MAX_BUFFER_SIZE_PSRAM = 512 * 1024;
+    static const uint32_t LOW_HEAP = 32 * 1024;
+    static const uint32_t LOW_PSRAM = 256 * 1024;
+
+    RollingStats fill_percent;
+    // audio.loop() time, SD reads included, per SAMPLES_PER_DECODE_FRAME output frames
+    RollingStats loop_time;
+
+    // Per sample interval accumulators.
+    unsigned long interval_start;
+    uint32_t interval_min_fill;
+    uint32_t interval_loop_us;
+    uint32_t interval_frames;
+
+    // Model of the I2S DMA queue: filled by decoded frames, drained at the
+    // sample rate. Running dry while playing is an underrun.
+    volatile uint32_t pending_frames; // bumped from the output callback
+    uint32_t queued_frames;
+    unsigned long last_drain_us;
+    bool starved;
+
+    uint32_t underruns;
+    uint32_t underruns_total;
+    uint32_t buffer_size;
+    uint32_t next_buffer_size;
+    uint32_t saved_buffer_size; // what STATE_PATH holds
+    bool resizable;             // false once the decoder refused a new buffer size
+    Storage* storage;
+
+    void sample();
+    void adapt();
+    uint32_t max_buffer_size() const;
+    void save();
+
+public:
+    // Where the size for the next boot is kept: the magic, then the size.
+    static const uint32_t STATE_MAGIC = 0x42415054; // "TPAB"
+    static constexpr const char* STATE_PATH = "/audio_buffer.bin";
+
+    AudioMonitor();
+
+    // Returns the buffer size an earlier boot settled on (0 if none) and keeps
+    // `storage` to save a new one in. Call before the decoder opens a track.
+    uint32_t restore(Storage& storage);
+    // Call at track start with the buffer size in effect; resets the
+    // per-track stats.
+    void start(uint32_t current_buffer_size);
+    // The decoder would not take recommended_buffer_size(); stop adapting.
+    void resize_failed();
+    // Call at track end; saves a changed recommendation for the next boot.
+    void stop();
+    // Call after a pause or seek, when the output stream restarts.
+    void resync();
+
+    void on_frame();
+    // After each decoder loop while playing.
+    void on_loop(uint32_t loop_us, uint32_t in_filled, uint32_t in_free, uint32_t sample_rate);
+
+    // Input buffer size the decoder should use from the next boot.
+    uint32_t recommended_buffer_size() const;
+
+    void report() const;
+};
\ No newline at end of file
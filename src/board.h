@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <hal/cpu_hal.h>
+#include <soc/gpio_struct.h>
+#endif
+
+// Board wiring as types. Every pin is a Pin<N>, so its bank and mask are
+// compile-time constants: a read in an ISR is one load of the GPIO input
+// register and a mask, with no pin lookup. The profile picks the GPIO backend,
+// real registers on the device and FakeGpio in a host build.
+
+#define BOARD_INLINE inline __attribute__((always_inline))
+
+template <uint8_t N>
+struct Pin {
+    static_assert(N <= 48, "the ESP32-S3 has GPIO 0-48");
+    static_assert(N < 26 || N > 32, "GPIO 26-32 are wired to the flash and PSRAM");
+    static_assert(N != 19 && N != 20, "GPIO 19/20 carry the native USB serial port");
+
+    static constexpr uint8_t number = N;
+    static constexpr int bank = N / 32; // GPIO.in holds 0-31, GPIO.in1 holds 32-48
+    static constexpr uint32_t mask = 1u << (N % 32);
+
+    // Level of this pin in a snapshot of its input bank.
+    static constexpr bool in(uint32_t bank_bits) {
+        return (bank_bits & mask) != 0;
+    }
+};
+
+template <int... N>
+constexpr bool pins_distinct() {
+    const int pins[] = {N...};
+    for (size_t i = 0; i < sizeof...(N); i++) {
+        for (size_t j = i + 1; j < sizeof...(N); j++) {
+            if (pins[i] == pins[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#if defined(ARDUINO)
+struct Esp32S3Gpio {
+    static BOARD_INLINE uint32_t input(int bank) {
+        return bank == 0 ? GPIO.in : GPIO.in1.val;
+    }
+    static BOARD_INLINE uint32_t cycles() {
+        return cpu_hal_get_cycle_count();
+    }
+};
+#endif
+
+// Host stand-in: tests drive the pin levels and the cycle counter directly.
+struct FakeGpio {
+    static inline uint32_t banks[2] = {0xFFFFFFFF, 0xFFFFFFFF}; // pulled up
+    static inline uint32_t cycle_count = 0;
+
+    template <class P>
+    static void set(bool level) {
+        banks[P::bank] = level ? banks[P::bank] | P::mask : banks[P::bank] & ~P::mask;
+    }
+    static uint32_t input(int bank) {
+        return banks[bank];
+    }
+    static uint32_t cycles() {
+        return cycle_count;
+    }
+};
+
+// Yellobyte YB-ESP32-S3-AMP v3. SPI, I2S and LED pins come from the board
+// variant and are only checked against ours when building for the device.
+struct YbEsp32S3AmpV3 {
+#if defined(ARDUINO)
+    using Gpio = Esp32S3Gpio;
+#else
+    using Gpio = FakeGpio;
+#endif
+    static constexpr uint32_t CPU_HZ = 240000000;
+
+    using EncoderSw = Pin<15>;
+    using EncoderDt = Pin<16>;
+    using EncoderClk = Pin<17>;
+    using OledSda = Pin<8>;
+    using OledScl = Pin<9>;
+    using NfcReset = Pin<2>;
+    static constexpr int8_t OLED_RESET = -1; // shares the board reset
+
+    static_assert(pins_distinct<EncoderSw::number, EncoderDt::number, EncoderClk::number, OledSda::number,
+                                OledScl::number, NfcReset::number>(),
+                  "two functions wired to the same GPIO");
+    static_assert(EncoderClk::bank == EncoderDt::bank, "the encoder ISR reads CLK and DT in one access");
+#if defined(ARDUINO)
+    static_assert(pins_distinct<EncoderSw::number, EncoderDt::number, EncoderClk::number, OledSda::number,
+                                OledScl::number, NfcReset::number, SS, SCK, MISO, MOSI, SS2, SCK2, MISO2,
+                                MOSI2, I2S_BCLK, I2S_LRCLK, I2S_DOUT>(),
+                  "a pin collides with the SD, NFC or I2S wiring of the board");
+    static_assert(F_CPU == CPU_HZ, "CPU_HZ must match the configured CPU clock");
+#endif
+
+    template <class P>
+    static BOARD_INLINE bool read() {
+        return P::in(Gpio::input(P::bank));
+    }
+
+    static constexpr uint32_t ms_to_cycles(uint32_t ms) {
+        return CPU_HZ / 1000 * ms;
+    }
+};
+
+using Board = YbEsp32S3AmpV3;
@@ -14,6 +14,10 @@ struct Config {
     int default_volume;
     String audiodb_path;
     String unknown_card_sfx;
+    String click_sfx;
+    int eq_bass_db;
+    int eq_mid_db;
+    int eq_treble_db;
     std::vector<Card> cards;
 };
 
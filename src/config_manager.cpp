@@ -1,9 +1,11 @@
 #include "config_manager.h"
 #include "debug.h"
-#include <FS.h>
-#include <SD.h>
+#include "storage_fs.h"
 #include <SPIFFS.h>
 #include <YAMLDuino.h>
+#include <memory>
+
+static FsStorage spiffs_storage(SPIFFS);
 
 String ConfigManager::get_yaml_string(const YAMLNode& parent, const char* key, const String& default_value) {
     YAMLNode node = parent[key];
@@ -15,37 +17,53 @@ int ConfigManager::get_yaml_int(const YAMLNode& parent, const char* key, int def
     return (!node.isNull() && node.isScalar()) ? atoi(node.scalar()) : default_value;
 }
 
-String ConfigManager::get_card_bmp_path(const Config& config, const Card& card) {
-    String audio_path = config.audiodb_path + "/" + card.file;
-    return audio_path + ".bmp";
+// Absolute paths (e.g. written onto a card) are used as-is.
+PathString ConfigManager::resolve_path(const char* audiodb_path, const char* file) {
+    if (file[0] == '/') {
+        return file;
+    }
+    PathString path = audiodb_path;
+    path += '/';
+    path += file;
+    return path;
+}
+
+PathString ConfigManager::get_card_bmp_path(const Config& config, const Card& card) {
+    PathString path = resolve_path(config.audiodb_path.c_str(), card.file.c_str());
+    path += ".bmp";
+    return path;
+}
+
+void ConfigManager::index_artwork(Config& config) {
+    for (auto& card : config.cards) {
+        card.has_photo = sd_storage.exists(get_card_bmp_path(config, card).c_str(), STORAGE_ARTWORK);
+    }
 }
 
 std::optional<Config> ConfigManager::load_config(const String& conf_path) {
-    File config_file;
+    StorageFile config_file = sd_storage.open(conf_path.c_str(), STORAGE_CONFIG);
 
-    if (SD.begin() && SD.exists(conf_path)) {
-        config_file = SD.open(conf_path);
+    if (config_file) {
         debug_print("Loading config from SD card");
     }
-    else if (SPIFFS.begin() && SPIFFS.exists(conf_path)) {
-        config_file = SPIFFS.open(conf_path);
+    else if (SPIFFS.begin() && (config_file = spiffs_storage.open(conf_path.c_str(), STORAGE_CONFIG))) {
         debug_print("Loading config from SPIFFS");
     } else {
         debug_print("Configuration file not found");
         return std::nullopt;
     }
 
-    String yaml_content = "";
-    while (config_file.available()) {
-        yaml_content += (char)config_file.read();
-    }
+    size_t size = config_file.size();
+    std::unique_ptr<char[]> yaml_content(new char[size + 1]);
+    size_t length = config_file.read(yaml_content.get(), size);
     config_file.close();
+    yaml_content[length] = '\0';
 
     debug_print("Parsing YAML configuration...");
 
     YAMLNode root;
     try {
-        root = YAMLNode::loadString(yaml_content.c_str());
+        root = YAMLNode::loadString(yaml_content.get());
     } catch (const std::exception& e) {
         debug_print("YAML parse error: %s", e.what());
         return std::nullopt;
@@ -61,6 +79,10 @@ std::optional<Config> ConfigManager::load_config(const String& conf_path) {
     config.default_volume = get_yaml_int(root, "default_volume", 10);
     config.audiodb_path = get_yaml_string(root, "audiodb_path", "audiodb");
     config.unknown_card_sfx = get_yaml_string(root, "unknown_card_sfx", "default.mp3");
+    config.click_sfx = get_yaml_string(root, "click_sfx");
+    config.eq_bass_db = get_yaml_int(root, "eq_bass_db", 0);
+    config.eq_mid_db = get_yaml_int(root, "eq_mid_db", -3);
+    config.eq_treble_db = get_yaml_int(root, "eq_treble_db", -2);
 
     YAMLNode cards_node = root["cards"];
     if (!cards_node.isNull() && cards_node.isSequence()) {
@@ -71,7 +93,7 @@ std::optional<Config> ConfigManager::load_config(const String& conf_path) {
                 card.id = get_yaml_string(card_node, "id");
                 card.file = get_yaml_string(card_node, "file");
                 card.name = get_yaml_string(card_node, "name");
-                card.has_photo = SD.exists(get_card_bmp_path(config, card));
+                card.has_photo = false;
 
                 if (!card.id.isEmpty() && !card.file.isEmpty()) {
                     config.cards.push_back(card);
@@ -84,6 +106,8 @@ std::optional<Config> ConfigManager::load_config(const String& conf_path) {
     debug_print("Default Volume: %d", config.default_volume);
     debug_print("Audio DB Path: %s", config.audiodb_path.c_str());
     debug_print("Unknown Card SFX: %s", config.unknown_card_sfx.c_str());
+    debug_print("Click SFX: %s", config.click_sfx.c_str());
+    debug_print("EQ (dB): bass=%d mid=%d treble=%d", config.eq_bass_db, config.eq_mid_db, config.eq_treble_db);
 
     debug_print("Cards loaded: %d", config.cards.size());
     for (const auto& card : config.cards) {
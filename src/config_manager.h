@@ -1,13 +1,19 @@
 #pragma once
 
 #include "config.h"
+#include "fixed_string.h"
 #include <optional>
 #include <YAMLDuino.h>
 
 class ConfigManager {
 public:
     static std::optional<Config> load_config(const String& conf_path);
-    static String get_card_bmp_path(const Config& config, const Card& card);
+    // Checks which cards have a bitmap next to their track. Kept out of
+    // load_config() since it costs an SD lookup per card.
+    static void index_artwork(Config& config);
+    // Paths too long for a PathString come back truncated; check truncated().
+    static PathString resolve_path(const char* audiodb_path, const char* file);
+    static PathString get_card_bmp_path(const Config& config, const Card& card);
 
 private:
     static String get_yaml_string(const class YAMLNode& parent, const char* key, const String& default_value = "");
@@ -8,12 +8,13 @@ void debug_print(const char* format, ...) {
     if (!debug) {
         return;
     }
+    // Formatted on the stack: Print::vprintf() mallocs for lines over 64 bytes.
+    char line[256];
     va_list args;
     va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
 
     Serial.print("[DEBUG] ");
-    Serial.vprintf(format, args);
-    Serial.println();
-
-    va_end(args);
+    Serial.println(line);
 }
\ No newline at end of file
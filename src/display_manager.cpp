@@ -1,22 +1,29 @@
 #include "display_manager.h"
 #include "debug.h"
-#include <SD.h>
+#include "storage_fs.h"
 
-DisplayManager::DisplayManager(Adafruit_SSD1306* display) : oled(display) {}
+DisplayManager::DisplayManager(Adafruit_SSD1306* display) : oled(display), ready(false) {}
 
-void DisplayManager::display_rows(const std::vector<String>& rows, int text_size) {
+void DisplayManager::set_ready() {
+    ready = true;
+}
+
+void DisplayManager::display_rows(std::initializer_list<const char*> rows, int text_size) {
+    if (!ready) {
+        return;
+    }
     oled->clearDisplay();
     oled->setCursor(0, 0);
     oled->setTextSize(text_size);
     
-    for (const auto& row : rows) {
+    for (const char* row : rows) {
         oled->println(row);
     }
     
     oled->display();
 }
 
-void DisplayManager::show_playing(const String& title) {
+void DisplayManager::show_playing(const char* title) {
     display_rows({"Now playing..", title});
 }
 
@@ -24,48 +31,53 @@ void DisplayManager::reset() {
     display_rows({"Tailpod 3000"});
 }
 
-void DisplayManager::draw_centered_bitmap(const String& bmp_path) {
+static uint32_t read_le(const uint8_t* p, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+void DisplayManager::draw_centered_bitmap(const char* bmp_path) {
+    if (!ready) {
+        return;
+    }
     oled->clearDisplay();
     
-    if (!SD.exists(bmp_path)) {
-        debug_print("File not found: %s", bmp_path.c_str());
+    StorageFile bmp_file = sd_storage.open(bmp_path, STORAGE_ARTWORK);
+    if (!bmp_file) {
+        debug_print("Failed to open file: %s", bmp_path);
         return;
     }
     
-    File bmp_file = SD.open(bmp_path);
-    if (!bmp_file) {
-        debug_print("Failed to open file: %s", bmp_path.c_str());
+    // File header and the start of the info header, up to the bit depth.
+    uint8_t header[30];
+    if (bmp_file.read(header, sizeof(header)) != sizeof(header)) {
+        debug_print("Truncated BMP: %s", bmp_path);
         return;
     }
     
-    uint16_t signature = bmp_file.read() | (bmp_file.read() << 8);
+    uint16_t signature = read_le(header, 2);
     if (signature != 0x4D42) {
         debug_print("Invalid BMP signature: 0x%X", signature);
-        bmp_file.close();
         return;
     }
     
-    bmp_file.seek(10);
-    uint32_t data_offset = bmp_file.read() | (bmp_file.read() << 8) | (bmp_file.read() << 16) | (bmp_file.read() << 24);
-    
-    bmp_file.seek(18);
-    int32_t width = bmp_file.read() | (bmp_file.read() << 8) | (bmp_file.read() << 16) | (bmp_file.read() << 24);
-    int32_t height = bmp_file.read() | (bmp_file.read() << 8) | (bmp_file.read() << 16) | (bmp_file.read() << 24);
-    
-    bmp_file.seek(28);
-    uint16_t bits_per_pixel = bmp_file.read() | (bmp_file.read() << 8);
+    uint32_t data_offset = read_le(header + 10, 4);
+    int32_t width = read_le(header + 18, 4);
+    int32_t height = read_le(header + 22, 4);
+    uint16_t bits_per_pixel = read_le(header + 28, 2);
     
     debug_print("BMP: %dx%d, %d-bit, data offset: %d", width, height, bits_per_pixel, data_offset);
     
     if (width <= 0 || height <= 0 || width > SCREEN_WIDTH || height > SCREEN_HEIGHT) {
         debug_print("Invalid dimensions: %dx%d (max: %dx%d)", width, height, SCREEN_WIDTH, SCREEN_HEIGHT);
-        bmp_file.close();
         return;
     }
     
     if (bits_per_pixel != 1) {
         debug_print("Only 1-bit BMPs supported, got %d-bit", bits_per_pixel);
-        bmp_file.close();
         return;
     }
     
@@ -76,15 +88,16 @@ void DisplayManager::draw_centered_bitmap(const String& bmp_path) {
     
     bmp_file.seek(data_offset);
     
-    int bytes_per_row = (width + 7) / 8;
     int padded_row_size = ((width + 31) / 32) * 4;
-    int padding_bytes = padded_row_size - bytes_per_row;
-    
-    debug_print("Row info: %d bytes per row, %d padding bytes", bytes_per_row, padding_bytes);
+    uint8_t row_bytes[(SCREEN_WIDTH + 31) / 32 * 4];
     
     for (int row = height - 1; row >= 0; row--) {
+        if (bmp_file.read(row_bytes, padded_row_size) != (size_t)padded_row_size) {
+            debug_print("Truncated BMP: %s", bmp_path);
+            break;
+        }
         for (int col = 0; col < width; col += 8) {
-            uint8_t pixel_byte = bmp_file.read();
+            uint8_t pixel_byte = row_bytes[col / 8];
             
             for (int bit = 7; bit >= 0 && (col + (7-bit)) < width; bit--) {
                 if (!(pixel_byte & (1 << bit))) {
@@ -92,10 +105,6 @@ void DisplayManager::draw_centered_bitmap(const String& bmp_path) {
                 }
             }
         }
-        
-        for (int i = 0; i < padding_bytes; i++) {
-            bmp_file.read();
-        }
     }
     
     bmp_file.close();
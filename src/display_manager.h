@@ -2,7 +2,8 @@
 
 #include <Adafruit_SSD1306.h>
 #include <Arduino.h>
-#include <vector>
+#include <atomic>
+#include <initializer_list>
 
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
@@ -10,12 +11,16 @@
 class DisplayManager {
 private:
     Adafruit_SSD1306* oled;
+    std::atomic<bool> ready; // set once the panel has been brought up
     
 public:
     DisplayManager(Adafruit_SSD1306* display);
     
-    void display_rows(const std::vector<String>& rows, int text_size = 1);
-    void show_playing(const String& title);
+    // Until this is called, drawing does nothing.
+    void set_ready();
+
+    void display_rows(std::initializer_list<const char*> rows, int text_size = 1);
+    void show_playing(const char* title);
     void reset();
-    void draw_centered_bitmap(const String& bmp_path);
+    void draw_centered_bitmap(const char* bmp_path);
 };
\ No newline at end of file
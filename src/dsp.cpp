@@ -0,0 +1,440 @@
+#include "dsp.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(ARDUINO) && CONFIG_IDF_TARGET_ESP32S3
+#define DSP_USE_PIE 1
+#endif
+
+static inline int16_t saturate16(int32_t v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return v;
+}
+
+void dsp_apply_gain_scalar(int16_t* samples, size_t count, int32_t gain_q15) {
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (samples[i] * gain_q15) >> 15;
+    }
+}
+
+#if DSP_USE_PIE
+// Eight lanes per EE.VMUL.S16, which shifts each product right by SAR - an
+// arithmetic shift, so it floors exactly like the scalar kernel. With a gain of
+// at most 32767 the result always fits in 16 bits. Needs 16-byte aligned data
+// and a multiple of 8 samples; no other code here touches the PIE registers.
+static void apply_gain_pie(int16_t* samples, size_t count, int16_t gain_q15) {
+    int16_t gain[8] __attribute__((aligned(16)));
+    for (auto& g : gain) {
+        g = gain_q15;
+    }
+    int16_t* src = samples;
+    int16_t* dst = samples;
+    size_t vectors = count / 8;
+
+    asm volatile(
+        "rsr.sar a9\n"
+        "movi a8, 15\n"
+        "wsr.sar a8\n"
+        "ee.vld.128.ip q1, %[gain], 0\n"
+        "loopnez %[n], 1f\n"
+        "ee.vld.128.ip q0, %[src], 16\n"
+        "ee.vmul.s16 q2, q0, q1\n"
+        "ee.vst.128.ip q2, %[dst], 16\n"
+        "1:\n"
+        "wsr.sar a9\n"
+        : [src] "+r"(src), [dst] "+r"(dst)
+        : [n] "r"(vectors), [gain] "r"(gain)
+        : "a8", "a9", "memory");
+}
+#endif
+
+void dsp_apply_gain(int16_t* samples, size_t count, int32_t gain_q15) {
+    if (gain_q15 >= DSP_UNITY) {
+        return;
+    }
+#if DSP_USE_PIE
+    if (((uintptr_t)samples & 15) == 0 && (count & 7) == 0) {
+        apply_gain_pie(samples, count, gain_q15);
+        return;
+    }
+#endif
+    dsp_apply_gain_scalar(samples, count, gain_q15);
+}
+
+const float EqStage::BAND_FREQUENCY[EQ_BANDS] = {150.0f, 3000.0f, 8000.0f};
+
+EqStage::EqStage() : sample_rate(44100) {
+    for (int band = 0; band < EQ_BANDS; band++) {
+        gain_db[band] = 0.0f;
+        design((EqBand)band);
+    }
+    reset();
+}
+
+const char* EqStage::name() const {
+    return "eq";
+}
+
+// RBJ audio EQ cookbook shelves and peak, Q = 0.707, quantised to Q24.
+void EqStage::design(EqBand band) {
+    Biquad& bq = bands[band];
+    bq.bypass = fabsf(gain_db[band]) < 0.1f;
+    if (bq.bypass) {
+        return;
+    }
+
+    float a = powf(10.0f, gain_db[band] / 40.0f);
+    float w0 = 2.0f * (float)M_PI * BAND_FREQUENCY[band] / sample_rate;
+    float cos_w0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * 0.707f);
+    float sqrt_a = 2.0f * sqrtf(a) * alpha;
+
+    float b0, b1, b2, a0, a1, a2;
+    switch (band) {
+        case EQ_BASS:
+            b0 = a * ((a + 1) - (a - 1) * cos_w0 + sqrt_a);
+            b1 = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+            b2 = a * ((a + 1) - (a - 1) * cos_w0 - sqrt_a);
+            a0 = (a + 1) + (a - 1) * cos_w0 + sqrt_a;
+            a1 = -2 * ((a - 1) + (a + 1) * cos_w0);
+            a2 = (a + 1) + (a - 1) * cos_w0 - sqrt_a;
+            break;
+        case EQ_MID:
+            b0 = 1 + alpha * a;
+            b1 = -2 * cos_w0;
+            b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a;
+            a1 = -2 * cos_w0;
+            a2 = 1 - alpha / a;
+            break;
+        default:
+            b0 = a * ((a + 1) + (a - 1) * cos_w0 + sqrt_a);
+            b1 = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+            b2 = a * ((a + 1) + (a - 1) * cos_w0 - sqrt_a);
+            a0 = (a + 1) - (a - 1) * cos_w0 + sqrt_a;
+            a1 = 2 * ((a - 1) - (a + 1) * cos_w0);
+            a2 = (a + 1) - (a - 1) * cos_w0 - sqrt_a;
+            break;
+    }
+
+    const float scale = (1 << COEFF_SHIFT) / a0;
+    bq.b0 = lroundf(b0 * scale);
+    bq.b1 = lroundf(b1 * scale);
+    bq.b2 = lroundf(b2 * scale);
+    bq.a1 = lroundf(a1 * scale);
+    bq.a2 = lroundf(a2 * scale);
+}
+
+void EqStage::process(int16_t* block, size_t frames) {
+    for (int band = 0; band < EQ_BANDS; band++) {
+        const Biquad& bq = bands[band];
+        if (bq.bypass) {
+            continue;
+        }
+        for (int ch = 0; ch < 2; ch++) {
+            BiquadState& st = state[band][ch];
+            int16_t* s = block + ch;
+            for (size_t i = 0; i < frames; i++, s += 2) {
+                int32_t x0 = *s;
+                int64_t acc = (int64_t)bq.b0 * x0 + (int64_t)bq.b1 * st.x1 + (int64_t)bq.b2 * st.x2 -
+                              (int64_t)bq.a1 * st.y1 - (int64_t)bq.a2 * st.y2 + st.error;
+                int32_t y = saturate16(acc >> COEFF_SHIFT);
+                st.error = acc - ((int64_t)y << COEFF_SHIFT);
+                if (st.error > (1 << COEFF_SHIFT) || st.error < -(1 << COEFF_SHIFT)) {
+                    st.error = 0; // saturated; don't carry the overflow forward
+                }
+                st.x2 = st.x1;
+                st.x1 = x0;
+                st.y2 = st.y1;
+                st.y1 = y;
+                *s = y;
+            }
+        }
+    }
+}
+
+void EqStage::set_sample_rate(uint32_t rate) {
+    if (rate == 0 || rate == sample_rate) {
+        return;
+    }
+    sample_rate = rate;
+    for (int band = 0; band < EQ_BANDS; band++) {
+        design((EqBand)band);
+    }
+    reset();
+}
+
+void EqStage::reset() {
+    memset(state, 0, sizeof(state));
+}
+
+void EqStage::set_gain(EqBand band, float db) {
+    if (db > MAX_GAIN_DB) db = MAX_GAIN_DB;
+    if (db < -MAX_GAIN_DB) db = -MAX_GAIN_DB;
+    gain_db[band] = db;
+    design(band);
+    memset(state[band], 0, sizeof(state[band]));
+}
+
+const uint8_t VolumeStage::LEVEL_GAIN[MAX_LEVEL + 1] = {0,  1,  2,  3,  4,  6,  8,  10, 12, 14, 17,
+                                                        20, 23, 27, 30, 34, 38, 43, 48, 52, 58, 64};
+
+VolumeStage::VolumeStage() : gain(DSP_UNITY << 15), target(DSP_UNITY << 15), step(0) {}
+
+const char* VolumeStage::name() const {
+    return "volume";
+}
+
+void VolumeStage::process(int16_t* block, size_t frames) {
+    if (step == 0) {
+        dsp_apply_gain(block, frames * 2, gain >> 15);
+        return;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        gain += step;
+        if ((step > 0 && gain >= target) || (step < 0 && gain <= target)) {
+            gain = target;
+            step = 0;
+        }
+        int32_t g = gain >> 15;
+        block[2 * i] = (block[2 * i] * g) >> 15;
+        block[2 * i + 1] = (block[2 * i + 1] * g) >> 15;
+    }
+}
+
+void VolumeStage::reset() {
+    gain = target;
+    step = 0;
+}
+
+void VolumeStage::set_gain(int32_t gain_q15) {
+    if (gain_q15 < 0) gain_q15 = 0;
+    if (gain_q15 > DSP_UNITY) gain_q15 = DSP_UNITY;
+    target = gain_q15 << 15;
+    step = (target - gain) / RAMP_FRAMES;
+    if (step == 0) {
+        gain = target;
+    }
+}
+
+void VolumeStage::set_level(uint8_t level) {
+    if (level > MAX_LEVEL) level = MAX_LEVEL;
+    set_gain(DSP_UNITY * LEVEL_GAIN[level] / 64);
+}
+
+LimiterStage::LimiterStage() {
+    reset();
+}
+
+const char* LimiterStage::name() const {
+    return "limiter";
+}
+
+int32_t LimiterStage::needed_gain(const int16_t* block, size_t count) {
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = block[i] < 0 ? -block[i] : block[i];
+        if (v > peak) {
+            peak = v;
+        }
+    }
+    return peak > THRESHOLD ? (THRESHOLD << 15) / peak : DSP_UNITY;
+}
+
+// Every sample spends one block in the delay line, and each call's gain target
+// covers both what leaves the line now and everything still in it. So the gain
+// has already come down by the time a loud sample leaves the line, and each
+// output sample ends up at or under the threshold.
+void LimiterStage::process(int16_t* block, size_t frames) {
+    const size_t line = DSP_BLOCK_FRAMES * 2;
+    size_t count = frames * 2;
+
+    int32_t need = needed_gain(delay, line);
+    int32_t incoming_need = needed_gain(block, count);
+    if (incoming_need < need) {
+        need = incoming_need;
+    }
+    int32_t released = gain + RELEASE_PER_FRAME * (int32_t)frames;
+    int32_t target = released < need ? released : need;
+
+    int16_t out[DSP_BLOCK_FRAMES * 2] __attribute__((aligned(16)));
+    memcpy(out, delay, count * sizeof(int16_t));
+    memmove(delay, delay + count, (line - count) * sizeof(int16_t));
+    memcpy(delay + line - count, block, count * sizeof(int16_t));
+
+    if (target == gain) {
+        dsp_apply_gain(out, count, gain);
+    } else {
+        int32_t start = gain;
+        for (size_t i = 0; i < frames; i++) {
+            int32_t g = start + (target - start) * (int32_t)(i + 1) / (int32_t)frames;
+            out[2 * i] = (out[2 * i] * g) >> 15;
+            out[2 * i + 1] = (out[2 * i + 1] * g) >> 15;
+        }
+        gain = target;
+    }
+
+    memcpy(block, out, count * sizeof(int16_t));
+}
+
+void LimiterStage::reset() {
+    memset(delay, 0, sizeof(delay));
+    gain = DSP_UNITY;
+}
+
+DspChain::DspChain() : stage_count(0), position(0) {
+    memset(input, 0, sizeof(input));
+    memset(output, 0, sizeof(output));
+}
+
+bool DspChain::add(DspStage* stage) {
+    if (stage_count == MAX_STAGES) {
+        return false;
+    }
+    stages[stage_count++] = stage;
+    return true;
+}
+
+size_t DspChain::size() const {
+    return stage_count;
+}
+
+DspStage* DspChain::stage(size_t index) const {
+    return stages[index];
+}
+
+void DspChain::process(int16_t* samples, size_t frames) {
+    while (frames > 0) {
+        size_t n = frames < DSP_BLOCK_FRAMES ? frames : DSP_BLOCK_FRAMES;
+        for (size_t i = 0; i < stage_count; i++) {
+            stages[i]->process(samples, n);
+        }
+        samples += n * 2;
+        frames -= n;
+    }
+}
+
+void DspChain::process_frame(int16_t* frame) {
+    input[2 * position] = frame[0];
+    input[2 * position + 1] = frame[1];
+    frame[0] = output[2 * position];
+    frame[1] = output[2 * position + 1];
+
+    if (++position == DSP_BLOCK_FRAMES) {
+        memcpy(output, input, sizeof(output));
+        process(output, DSP_BLOCK_FRAMES);
+        position = 0;
+    }
+}
+
+void DspChain::set_sample_rate(uint32_t rate) {
+    for (size_t i = 0; i < stage_count; i++) {
+        stages[i]->set_sample_rate(rate);
+    }
+}
+
+void DspChain::reset() {
+    for (size_t i = 0; i < stage_count; i++) {
+        stages[i]->reset();
+    }
+    memset(input, 0, sizeof(input));
+    memset(output, 0, sizeof(output));
+    position = 0;
+}
+
+static const size_t BENCH_BLOCKS = 64;
+
+static void fill_noise(int16_t* block, size_t count, uint32_t& seed) {
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        block[i] = (int16_t)(seed >> 16);
+    }
+}
+
+size_t dsp_benchmark(uint32_t (*cycle_counter)(), DspBenchmark* results, size_t max_results) {
+    EqStage eq;
+    eq.set_gain(EQ_BASS, 3.0f);
+    eq.set_gain(EQ_MID, -3.0f);
+    eq.set_gain(EQ_TREBLE, -2.0f);
+    VolumeStage volume;
+    volume.set_gain(DSP_UNITY / 2);
+    volume.reset(); // skip the ramp, time the steady state
+    LimiterStage limiter;
+    DspStage* stages[] = {&eq, &volume, &limiter};
+
+    int16_t block[DSP_BLOCK_FRAMES * 2] __attribute__((aligned(16)));
+    const uint32_t samples = BENCH_BLOCKS * DSP_BLOCK_FRAMES * 2;
+    size_t n = 0;
+
+    for (DspStage* stage : stages) {
+        if (n == max_results) {
+            break;
+        }
+        uint32_t seed = 1;
+        uint32_t cycles = 0;
+        for (size_t b = 0; b < BENCH_BLOCKS; b++) {
+            fill_noise(block, DSP_BLOCK_FRAMES * 2, seed);
+            uint32_t start = cycle_counter();
+            stage->process(block, DSP_BLOCK_FRAMES);
+            cycles += cycle_counter() - start;
+        }
+        results[n++] = {stage->name(), (uint32_t)((uint64_t)cycles * 100 / samples)};
+    }
+
+    typedef void (*GainKernel)(int16_t*, size_t, int32_t);
+    const struct {
+        const char* name;
+        GainKernel kernel;
+    } kernels[] = {
+        {"gain (scalar)", dsp_apply_gain_scalar},
+        {"gain", dsp_apply_gain},
+    };
+    for (const auto& k : kernels) {
+        if (n == max_results) {
+            break;
+        }
+        uint32_t seed = 1;
+        uint32_t cycles = 0;
+        for (size_t b = 0; b < BENCH_BLOCKS; b++) {
+            fill_noise(block, DSP_BLOCK_FRAMES * 2, seed);
+            uint32_t start = cycle_counter();
+            k.kernel(block, DSP_BLOCK_FRAMES * 2, 23197); // -3 dB
+            cycles += cycle_counter() - start;
+        }
+        results[n++] = {k.name, (uint32_t)((uint64_t)cycles * 100 / samples)};
+    }
+    return n;
+}
+
+uint32_t dsp_compare_gain_kernels(uint32_t* samples) {
+    static const int32_t GAINS[] = {0, 1, 4096, 16384, 23197, 32767, DSP_UNITY};
+    // Each gain runs once on 16-byte aligned blocks, which take the vector
+    // path where there is one, and once a sample off, which falls back.
+    int16_t expected[DSP_BLOCK_FRAMES * 2 + 8] __attribute__((aligned(16)));
+    int16_t actual[DSP_BLOCK_FRAMES * 2 + 8] __attribute__((aligned(16)));
+    const size_t count = DSP_BLOCK_FRAMES * 2;
+    uint32_t mismatches = 0;
+    uint32_t compared = 0;
+
+    for (int32_t gain : GAINS) {
+        for (size_t offset = 0; offset < 2; offset++) {
+            uint32_t seed = gain + 1;
+            for (size_t b = 0; b < BENCH_BLOCKS; b++) {
+                fill_noise(expected + offset, count, seed);
+                memcpy(actual + offset, expected + offset, count * sizeof(int16_t));
+                if (gain < DSP_UNITY) {
+                    dsp_apply_gain_scalar(expected + offset, count, gain);
+                }
+                dsp_apply_gain(actual + offset, count, gain);
+                for (size_t i = 0; i < count; i++) {
+                    mismatches += expected[offset + i] != actual[offset + i];
+                }
+                compared += count;
+            }
+        }
+    }
+    *samples = compared;
+    return mismatches;
+}
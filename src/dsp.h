@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point output processing between the decoder and I2S. Everything works
+// on blocks of interleaved 16-bit stereo and is free of Arduino dependencies,
+// so the kernels build and behave identically on a Linux host.
+
+static const size_t DSP_BLOCK_FRAMES = 32;
+static const int32_t DSP_UNITY = 32768; // Q15 gain of 1.0
+
+// Multiplies every sample by a Q15 gain (<= DSP_UNITY), rounding toward
+// negative infinity. The ESP32-S3 build uses the PIE vector unit; the scalar
+// version is the reference and gives bit-identical results.
+void dsp_apply_gain(int16_t* samples, size_t count, int32_t gain_q15);
+void dsp_apply_gain_scalar(int16_t* samples, size_t count, int32_t gain_q15);
+
+class DspStage {
+public:
+    virtual ~DspStage() {}
+    virtual const char* name() const = 0;
+    // Processes `frames` (<= DSP_BLOCK_FRAMES) stereo frames in place.
+    virtual void process(int16_t* block, size_t frames) = 0;
+    virtual void set_sample_rate(uint32_t) {}
+    virtual void reset() {}
+};
+
+enum EqBand {
+    EQ_BASS,   // low shelf
+    EQ_MID,    // peaking
+    EQ_TREBLE, // high shelf
+    EQ_BANDS,
+};
+
+// One biquad per band and channel, Direct Form I with Q24 coefficients and
+// first-order error feedback so low shelves stay clean at 16 bits. The bass
+// shelf's poles sit close to DC, where Q14 rounding alone moved its gain by
+// over 2 dB. Band gains are held to +/-MAX_GAIN_DB, which keeps every
+// coefficient well inside 32 bits.
+class EqStage : public DspStage {
+private:
+    static const int COEFF_SHIFT = 24;
+
+    struct Biquad {
+        int32_t b0, b1, b2, a1, a2; // Q24, a0 normalised to 1
+        bool bypass;
+    };
+
+    struct BiquadState {
+        int32_t x1, x2, y1, y2;
+        int64_t error;
+    };
+
+    Biquad bands[EQ_BANDS];
+    BiquadState state[EQ_BANDS][2];
+    float gain_db[EQ_BANDS];
+    uint32_t sample_rate;
+
+    void design(EqBand band);
+
+public:
+    static const float BAND_FREQUENCY[EQ_BANDS];
+    static constexpr float MAX_GAIN_DB = 12.0f;
+
+    EqStage();
+    const char* name() const override;
+    void process(int16_t* block, size_t frames) override;
+    void set_sample_rate(uint32_t rate) override;
+    void reset() override;
+    void set_gain(EqBand band, float db);
+};
+
+// Applies the playback volume, ramping to a new level over RAMP_FRAMES so
+// steps don't click (zipper noise).
+class VolumeStage : public DspStage {
+public:
+    static const uint8_t MAX_LEVEL = 21;
+
+private:
+    static const int32_t RAMP_FRAMES = 512; // ~12 ms at 44.1 kHz
+    // Gain per level in 64ths: the curve ESP32-audioI2S 2.0.0 applies in its
+    // own setVolume(), which the decoder now leaves at full scale.
+    static const uint8_t LEVEL_GAIN[MAX_LEVEL + 1];
+
+    int32_t gain;   // Q30
+    int32_t target; // Q30
+    int32_t step;   // per frame
+
+public:
+    VolumeStage();
+    const char* name() const override;
+    void process(int16_t* block, size_t frames) override;
+    void reset() override;
+    void set_gain(int32_t gain_q15);
+    // 0 (silent) to MAX_LEVEL (unity) on the decoder's volume curve.
+    void set_level(uint8_t level);
+};
+
+// Look-ahead peak limiter. Output is delayed by one block, so the gain has
+// already ramped down by the time a peak that would clip reaches the output.
+// Expects full blocks; a short one just shortens the look-ahead once.
+class LimiterStage : public DspStage {
+private:
+    static const int32_t THRESHOLD = 29204;    // -1 dBFS
+    static const int32_t RELEASE_PER_FRAME = 4; // Q15, ~0.3 s from -6 dB to unity
+
+    int16_t delay[DSP_BLOCK_FRAMES * 2];
+    int32_t gain; // Q15
+
+    static int32_t needed_gain(const int16_t* block, size_t count);
+
+public:
+    LimiterStage();
+    const char* name() const override;
+    void process(int16_t* block, size_t frames) override;
+    void reset() override;
+};
+
+class DspChain {
+private:
+    static const size_t MAX_STAGES = 6;
+
+    DspStage* stages[MAX_STAGES];
+    size_t stage_count;
+
+    // Per-frame adapter: frames are collected into `input` while the previous
+    // block drains from `output`, one block of latency.
+    int16_t input[DSP_BLOCK_FRAMES * 2] __attribute__((aligned(16)));
+    int16_t output[DSP_BLOCK_FRAMES * 2] __attribute__((aligned(16)));
+    size_t position;
+
+public:
+    DspChain();
+
+    bool add(DspStage* stage);
+    size_t size() const;
+    DspStage* stage(size_t index) const;
+
+    // Runs every stage over `frames` stereo frames, in blocks.
+    void process(int16_t* samples, size_t frames);
+    // Feeds one stereo frame in and replaces it with the frame due out.
+    void process_frame(int16_t* frame);
+
+    void set_sample_rate(uint32_t rate);
+    void reset();
+};
+
+struct DspBenchmark {
+    const char* name;
+    uint32_t cycles_per_sample_x100;
+};
+
+// Times each stage of a reference chain (every EQ band active, volume at
+// -6 dB, the limiter) and both gain kernels over a burst of pseudo-random
+// blocks. The stages are the benchmark's own, so running it during playback
+// leaves the live chain alone. `cycle_counter` is the platform's cycle
+// counter. Returns the number of results written.
+size_t dsp_benchmark(uint32_t (*cycle_counter)(), DspBenchmark* results, size_t max_results);
+
+// Runs dsp_apply_gain() and dsp_apply_gain_scalar() over the same
+// pseudo-random blocks at a range of gains, aligned and not, and returns how
+// many samples differ. `samples` receives how many were compared.
+uint32_t dsp_compare_gain_kernels(uint32_t* samples);
@@ -0,0 +1,247 @@
+#include "event_trace.h"
+#include "alloc_guard.h"
+#include "debug.h"
+
+const char* EventTrace::TRACE_PATH = "/trace.bin";
+
+static const char* EVENT_NAMES[TRACE_EVENT_TYPES] = {
+    "nfc tap", "nfc removed", "encoder cw", "encoder ccw",
+    "button down", "button up", "serial key", "audio eof",
+};
+
+EventTrace::EventTrace(Dispatcher dispatcher)
+    : dispatcher(dispatcher), mode(MODE_LIVE), start_ms(0), last_time_ms(0), realtime(true),
+      has_next(false), event_count(0), state_signature(0), write_ok(true) {
+    reset_stats();
+}
+
+void EventTrace::reset_stats() {
+    for (auto& stats : latency) {
+        stats = {0, UINT32_MAX, 0, 0};
+    }
+    event_count = 0;
+    state_signature = 2166136261u; // FNV-1a offset basis
+    allocations_at_start = AllocGuard::count();
+    exempt_allocations_at_start = AllocGuard::exempt_count();
+}
+
+void EventTrace::dispatch(const TraceEvent& event) {
+    unsigned long start = micros();
+    int state = dispatcher(event);
+    uint32_t elapsed = micros() - start;
+
+    LatencyStats& stats = latency[event.type];
+    stats.count++;
+    stats.min_us = min(stats.min_us, elapsed);
+    stats.max_us = max(stats.max_us, elapsed);
+    stats.total_us += elapsed;
+
+    // Fold (event, resulting state) into a signature, so two replays of one
+    // trace can be compared at a glance.
+    for (uint8_t b : {(uint8_t)event.type, (uint8_t)state}) {
+        state_signature = (state_signature ^ b) * 16777619u;
+    }
+    event_count++;
+}
+
+void EventTrace::submit(TraceEventType type, const uint8_t* payload, uint8_t length) {
+    if (mode == MODE_REPLAYING) {
+        return;
+    }
+
+    TraceEvent event;
+    event.time_ms = millis() - start_ms;
+    event.type = type;
+    event.length = length < TraceEvent::MAX_PAYLOAD ? length : TraceEvent::MAX_PAYLOAD;
+    if (event.length > 0) {
+        memcpy(event.payload, payload, event.length);
+    }
+
+    if (mode == MODE_RECORDING) {
+        write_event(event);
+    }
+    dispatch(event);
+}
+
+void EventTrace::write_event(const TraceEvent& event) {
+    uint8_t header[8];
+    size_t n = 0;
+    uint32_t delta = event.time_ms - last_time_ms;
+    do {
+        header[n++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+        delta >>= 7;
+    } while (delta);
+    header[n++] = event.type;
+    header[n++] = event.length;
+
+    if (!write_ok) {
+        return;
+    }
+    // Writes are buffered, so a failure may surface a few events late.
+    if (file.write(header, n) != n || file.write(event.payload, event.length) != event.length) {
+        write_ok = false;
+        debug_print("Trace: writing %s failed, the trace ends before event %u", TRACE_PATH, event_count + 1);
+        return;
+    }
+    last_time_ms = event.time_ms;
+}
+
+bool EventTrace::read_event(TraceEvent& event) {
+    uint32_t delta = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int b = file.read();
+        if (b < 0) {
+            return false;
+        }
+        delta |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+
+    int type = file.read();
+    int length = file.read();
+    if (type < 0 || type >= TRACE_EVENT_TYPES || length < 0 || length > (int)TraceEvent::MAX_PAYLOAD) {
+        return false;
+    }
+
+    event.time_ms = last_time_ms + delta;
+    event.type = (TraceEventType)type;
+    event.length = length;
+    if (file.read(event.payload, length) != (size_t)length) {
+        return false;
+    }
+    last_time_ms = event.time_ms;
+    return true;
+}
+
+bool EventTrace::start_recording(Storage& storage) {
+    if (mode != MODE_LIVE) {
+        return false;
+    }
+    file = storage.open(TRACE_PATH, STORAGE_TRACE, true);
+    if (!file) {
+        debug_print("Trace: cannot create %s", TRACE_PATH);
+        return false;
+    }
+
+    uint8_t header[5];
+    uint32_t magic = MAGIC;
+    memcpy(header, &magic, sizeof(magic));
+    header[4] = VERSION;
+    if (file.write(header, sizeof(header)) != sizeof(header)) {
+        debug_print("Trace: cannot write %s", TRACE_PATH);
+        file.close();
+        return false;
+    }
+    mode = MODE_RECORDING;
+    write_ok = true;
+    start_ms = millis();
+    last_time_ms = 0;
+    reset_stats();
+    debug_print("Trace: recording to %s", TRACE_PATH);
+    return true;
+}
+
+void EventTrace::stop_recording() {
+    if (mode != MODE_RECORDING) {
+        return;
+    }
+    if (!file.close() && write_ok) {
+        write_ok = false;
+        debug_print("Trace: writing %s failed, its last events are lost", TRACE_PATH);
+    }
+    mode = MODE_LIVE;
+    report(write_ok ? "recording" : "recording (INCOMPLETE)");
+}
+
+bool EventTrace::start_replay(Storage& storage, bool realtime_replay) {
+    if (mode != MODE_LIVE) {
+        return false;
+    }
+    file = storage.open(TRACE_PATH, STORAGE_TRACE);
+    if (!file) {
+        debug_print("Trace: no trace at %s", TRACE_PATH);
+        return false;
+    }
+
+    uint32_t magic = 0;
+    if (file.read(&magic, sizeof(magic)) != sizeof(magic) || magic != MAGIC ||
+        file.read() != VERSION) {
+        debug_print("Trace: %s is not a trace file", TRACE_PATH);
+        file.close();
+        return false;
+    }
+
+    mode = MODE_REPLAYING;
+    realtime = realtime_replay;
+    start_ms = millis();
+    last_time_ms = 0;
+    reset_stats();
+    has_next = read_event(next_event);
+    debug_print("Trace: replaying %s (%s)", TRACE_PATH, realtime ? "realtime" : "fast");
+    return true;
+}
+
+void EventTrace::stop_replay() {
+    if (mode != MODE_REPLAYING) {
+        return;
+    }
+    file.close();
+    has_next = false;
+    mode = MODE_LIVE;
+    start_ms = 0;
+    report("replay");
+}
+
+bool EventTrace::is_recording() const {
+    return mode == MODE_RECORDING;
+}
+
+bool EventTrace::is_replaying() const {
+    return mode == MODE_REPLAYING;
+}
+
+uint32_t EventTrace::events() const {
+    return event_count;
+}
+
+uint32_t EventTrace::signature() const {
+    return state_signature;
+}
+
+bool EventTrace::recording_complete() const {
+    return write_ok;
+}
+
+void EventTrace::loop() {
+    if (mode != MODE_REPLAYING) {
+        return;
+    }
+    if (!has_next) {
+        stop_replay();
+        return;
+    }
+    if (realtime && millis() - start_ms < next_event.time_ms) {
+        return;
+    }
+
+    dispatch(next_event);
+    has_next = read_event(next_event);
+}
+
+void EventTrace::report(const char* label) {
+    debug_print("=== Trace %s: %u events, state signature %08X ===", label, event_count, state_signature);
+    for (int type = 0; type < TRACE_EVENT_TYPES; type++) {
+        const LatencyStats& stats = latency[type];
+        if (stats.count == 0) {
+            continue;
+        }
+        debug_print("  %-12s n=%u min=%uus avg=%uus max=%uus", EVENT_NAMES[type], stats.count,
+                    stats.min_us, (uint32_t)(stats.total_us / stats.count), stats.max_us);
+    }
+
+    uint32_t allocations = AllocGuard::count() - allocations_at_start;
+    uint32_t exempt = AllocGuard::exempt_count() - exempt_allocations_at_start;
+    debug_print("  heap allocations: %u (+%u exempt)", allocations, exempt);
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Arduino.h>
+#include "storage.h"
+
+enum TraceEventType : uint8_t {
+    TRACE_NFC_TAP,        // payload: UID, '\0', NDEF path
+    TRACE_NFC_REMOVED,
+    TRACE_ENCODER_CW,
+    TRACE_ENCODER_CCW,
+    TRACE_BUTTON_DOWN,
+    TRACE_BUTTON_UP,
+    TRACE_SERIAL_KEY,     // payload: the key
+    TRACE_AUDIO_EOF,
+    TRACE_EVENT_TYPES,
+};
+
+struct TraceEvent {
+    static const size_t MAX_PAYLOAD = 192;
+
+    uint32_t time_ms; // since the trace started
+    TraceEventType type;
+    uint8_t length;
+    uint8_t payload[MAX_PAYLOAD];
+};
+
+// Funnel for every external event. Events are dispatched to their handlers from
+// here, optionally appended to a binary trace on SD, and a recorded trace can be
+// fed back through the same handlers to reproduce timing-related bugs.
+//
+// The report at the end also gives the heap allocations the main loop made in
+// the meantime, a quick look at the zero-allocation steady state on the device.
+// The host test in test/test_alloc_soak is what enforces it.
+//
+// Trace file: "TPTR", version byte, then per event a varint time delta (ms),
+// type, payload length and payload.
+class EventTrace {
+public:
+    // Handles one event and returns the resulting app state, which feeds the
+    // replay's state signature.
+    typedef int (*Dispatcher)(const TraceEvent& event);
+
+private:
+    static const uint32_t MAGIC = 0x52545054; // "TPTR"
+    static const uint8_t VERSION = 1;
+
+    struct LatencyStats {
+        uint32_t count;
+        uint32_t min_us;
+        uint32_t max_us;
+        uint64_t total_us;
+    };
+
+    enum Mode {
+        MODE_LIVE,
+        MODE_RECORDING,
+        MODE_REPLAYING,
+    };
+
+    Dispatcher dispatcher;
+    Mode mode;
+    StorageFile file;
+    unsigned long start_ms;
+    uint32_t last_time_ms;
+    bool realtime;
+    bool has_next;
+    TraceEvent next_event;
+    uint32_t event_count;
+    uint32_t state_signature;
+    LatencyStats latency[TRACE_EVENT_TYPES];
+    uint32_t allocations_at_start;        // AllocGuard counts when the trace began
+    uint32_t exempt_allocations_at_start;
+    bool write_ok; // every event so far reached the trace file
+
+    void dispatch(const TraceEvent& event);
+    void write_event(const TraceEvent& event);
+    bool read_event(TraceEvent& event);
+    void reset_stats();
+    void report(const char* label);
+
+public:
+    static const char* TRACE_PATH;
+
+    EventTrace(Dispatcher dispatcher);
+
+    // Live events are dropped while a replay is running, so the replay alone
+    // drives the handlers.
+    void submit(TraceEventType type, const uint8_t* payload = nullptr, uint8_t length = 0);
+
+    bool start_recording(Storage& storage);
+    void stop_recording();
+    // With realtime set, events keep their recorded spacing; otherwise one is
+    // dispatched per loop.
+    bool start_replay(Storage& storage, bool realtime);
+    void stop_replay();
+    bool is_recording() const;
+    bool is_replaying() const;
+    // Of the current or last recording or replay, as in its report.
+    uint32_t events() const;
+    uint32_t signature() const;
+    // False once a recording failed to write (SD card full or failing); the
+    // trace then ends early.
+    bool recording_complete() const;
+
+    void loop();
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+// A string with its characters stored inline, for the paths and UIDs handled
+// on every tap: it lives on the stack or inside its owner and never touches
+// the heap. Text beyond the capacity is dropped and flagged as truncated.
+template <size_t N>
+class FixedString {
+private:
+    char text[N + 1];
+    size_t len;
+    bool overflow;
+
+public:
+    FixedString() : len(0), overflow(false) {
+        text[0] = '\0';
+    }
+
+    FixedString(const char* s) : FixedString() {
+        append(s);
+    }
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    FixedString& operator=(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    FixedString& append(const char* s, size_t n) {
+        size_t room = N - len;
+        if (n > room) {
+            n = room;
+            overflow = true;
+        }
+        memcpy(text + len, s, n);
+        len += n;
+        text[len] = '\0';
+        return *this;
+    }
+
+    FixedString& append(const char* s) {
+        return append(s, strlen(s));
+    }
+
+    FixedString& append(char c) {
+        return append(&c, 1);
+    }
+
+    FixedString& operator+=(const char* s) {
+        return append(s);
+    }
+
+    FixedString& operator+=(char c) {
+        return append(c);
+    }
+
+    void clear() {
+        len = 0;
+        overflow = false;
+        text[0] = '\0';
+    }
+
+    // Strips leading and trailing whitespace in place.
+    void trim() {
+        size_t start = 0;
+        while (start < len && (unsigned char)text[start] <= ' ') {
+            start++;
+        }
+        while (len > start && (unsigned char)text[len - 1] <= ' ') {
+            len--;
+        }
+        memmove(text, text + start, len - start);
+        len -= start;
+        text[len] = '\0';
+    }
+
+    const char* c_str() const {
+        return text;
+    }
+
+    size_t length() const {
+        return len;
+    }
+
+    bool empty() const {
+        return len == 0;
+    }
+
+    bool truncated() const {
+        return overflow;
+    }
+
+    bool starts_with(const char* prefix) const {
+        return strncmp(text, prefix, strlen(prefix)) == 0;
+    }
+
+    bool ends_with(const char* suffix) const {
+        size_t n = strlen(suffix);
+        return n <= len && memcmp(text + len - n, suffix, n) == 0;
+    }
+
+    bool operator==(const char* s) const {
+        return strcmp(text, s) == 0;
+    }
+
+    template <size_t M>
+    bool operator==(const FixedString<M>& other) const {
+        return strcmp(text, other.c_str()) == 0;
+    }
+};
+
+// A 10-byte UID as "AA:BB:...", and any path on the card.
+typedef FixedString<32> UidString;
+typedef FixedString<192> PathString;
\ No newline at end of file
@@ -7,16 +7,29 @@
 SPIClass* Hardware::spi_rc522 = new SPIClass(HSPI);
 SPIClass* Hardware::spi_onboard_sd = new SPIClass(FSPI);
 
+const uint32_t Hardware::SD_FREQUENCIES[] = {40000000, 20000000, 10000000, 4000000, 0};
+
 extern Adafruit_SSD1306 display;
 
+// A card can mount at a clock it can't sustain, so each step also reads the
+// root directory before settling on it.
 bool Hardware::initialize_sd_card() {
     spi_onboard_sd->begin();
-    if (!SD.begin(SS, *spi_onboard_sd)) {
-        debug_print("error mounting microSD");
-        return false;
+    for (int i = 0; SD_FREQUENCIES[i] != 0; i++) {
+        uint32_t frequency = SD_FREQUENCIES[i];
+        if (SD.begin(SS, *spi_onboard_sd, frequency, "/sd", SD_MAX_OPEN_FILES) && SD.cardType() != CARD_NONE) {
+            File root = SD.open("/");
+            bool readable = root && root.isDirectory();
+            root.close();
+            if (readable) {
+                debug_print("SD card initialized at %u MHz", frequency / 1000000);
+                return true;
+            }
+        }
+        SD.end();
     }
-    debug_print("SD card initialized");
-    return true;
+    debug_print("error mounting microSD");
+    return false;
 }
 
 bool Hardware::initialize_display() {
@@ -2,11 +2,13 @@
 
 #include <SPI.h>
 
-#define OLED_RESET -1
-#define OLED_SDA_PIN 8
-#define OLED_SCL_PIN 9
-
 class Hardware {
+private:
+    // SD SPI clocks to try, fastest first. The card sits on the FSPI IO-MUX
+    // pins, which carry up to 40 MHz; longer traces or slow cards fall back.
+    static const uint32_t SD_FREQUENCIES[];
+    static const uint8_t SD_MAX_OPEN_FILES = 8;
+
 public:
     static SPIClass* spi_rc522;
     static SPIClass* spi_onboard_sd;
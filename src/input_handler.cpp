@@ -1,44 +1,39 @@
 #include "input_handler.h"
 #include "debug.h"
+#include "storage_fs.h"
 #include <Arduino.h>
 
 // Static instance for interrupt handling
 InputHandler* InputHandler::instance = nullptr;
 
-InputHandler::InputHandler(App& application) 
-    : app(application), rotation_detected(false), clockwise(false), 
-      last_button_state(HIGH), last_button_press_time(0), last_rotation_time(0) {
+InputHandler::InputHandler(App& application, EventTrace& event_trace) 
+    : app(application), trace(event_trace), rotation_detected(false), clockwise(false), 
+      last_button_state(HIGH), button_down(false), button_held(false), scrubbed(false), last_button_press_time(0),
+      last_button_low_time(0) {
     instance = this;
 }
 
+// One input register read covers both CLK and DT, and the cycle counter
+// stands in for millis(), so the handler makes no function calls.
 void IRAM_ATTR InputHandler::rotary_interrupt() {
     if (instance) {
-        unsigned long current_time = millis();
-        if (current_time - instance->last_rotation_time < instance->ROTATION_DEBOUNCE) {
-            return; // Too soon, ignore
-        }
-        
-        // Read both pins
-        bool clk_state = digitalRead(ENCODER_CLK_PIN);
-        bool dt_state = digitalRead(ENCODER_DT_PIN);
-        
-        // Only process on falling edge of CLK (one complete step)
-        if (!clk_state) {
-            instance->clockwise = (clk_state != dt_state);
+        uint32_t port = Board::Gpio::input(Board::EncoderClk::bank);
+        int step = instance->encoder.on_edge(port, Board::Gpio::cycles());
+        if (step != 0) {
+            instance->clockwise = step > 0;
             instance->rotation_detected = true;
-            instance->last_rotation_time = current_time;
         }
     }
 }
 
 void InputHandler::initialize() {
-    pinMode(ENCODER_SW_PIN, INPUT_PULLUP);
-    pinMode(ENCODER_DT_PIN, INPUT_PULLUP);
-    pinMode(ENCODER_CLK_PIN, INPUT_PULLUP);
+    pinMode(Board::EncoderSw::number, INPUT_PULLUP);
+    pinMode(Board::EncoderDt::number, INPUT_PULLUP);
+    pinMode(Board::EncoderClk::number, INPUT_PULLUP);
     
-    last_button_state = digitalRead(ENCODER_SW_PIN);
+    last_button_state = Board::read<Board::EncoderSw>();
     
-    attachInterrupt(digitalPinToInterrupt(ENCODER_CLK_PIN), rotary_interrupt, FALLING);
+    attachInterrupt(digitalPinToInterrupt(Board::EncoderClk::number), rotary_interrupt, FALLING);
     
     debug_print("Rotary encoder initialized with interrupt");
 }
@@ -50,6 +45,32 @@ void InputHandler::handle_keyboard_input() {
 
     char key = Serial.read();
 
+    // Trace controls act directly and are never recorded themselves.
+    switch (key) {
+        case 't':
+            if (trace.is_recording()) {
+                trace.stop_recording();
+            } else {
+                trace.start_recording(sd_storage);
+            }
+            return;
+        case 'r':
+        case 'f':
+            if (trace.is_replaying()) {
+                trace.stop_replay();
+            } else {
+                trace.start_replay(sd_storage, key == 'r');
+            }
+            return;
+        default:
+            break;
+    }
+
+    uint8_t payload = key;
+    trace.submit(TRACE_SERIAL_KEY, &payload, 1);
+}
+
+void InputHandler::on_key(char key) {
     switch (key) {
         case 'p':
             debug_print("pause/resume");
@@ -71,37 +92,82 @@ void InputHandler::handle_keyboard_input() {
             debug_print("info");
             app.show_info();
             break;
+        case 'b':
+            debug_print("dsp benchmark");
+            app.run_dsp_benchmark();
+            break;
+        case '>':
+            debug_print("seek forward");
+            app.seek_by(KEY_SEEK_STEP);
+            break;
+        case '<':
+            debug_print("seek back");
+            app.seek_by(-KEY_SEEK_STEP);
+            break;
         default:
             break;
     }
 }
 
+void InputHandler::on_rotation(bool cw) {
+    if (button_held) {
+        debug_print("Rotary encoder: scrub %s", cw ? "forward" : "back");
+        app.seek_by(cw ? SCRUB_STEP : -SCRUB_STEP);
+        scrubbed = true;
+    } else if (cw) {
+        debug_print("Rotary encoder: clockwise - increasing volume");
+        app.incr_volume();
+    } else {
+        debug_print("Rotary encoder: counterclockwise - decreasing volume");
+        app.decr_volume();
+    }
+}
+
+void InputHandler::on_button_down() {
+    button_held = true;
+    scrubbed = false;
+}
+
+// Play/pause fires on release, so press-and-rotate can scrub instead
+void InputHandler::on_button_up() {
+    if (!button_held) {
+        return;
+    }
+    button_held = false;
+    if (!scrubbed) {
+        debug_print("Rotary encoder button pressed - toggle play/pause");
+        app.toggle_play_pause();
+    }
+}
+
 void InputHandler::handle_rotary_encoder() {
     if (rotation_detected) {
         rotation_detected = false;
-        
-        if (clockwise) {
-            debug_print("Rotary encoder: clockwise - increasing volume");
-            app.incr_volume();
-        } else {
-            debug_print("Rotary encoder: counterclockwise - decreasing volume");
-            app.decr_volume();
-        }
+        trace.submit(clockwise ? TRACE_ENCODER_CW : TRACE_ENCODER_CCW);
     }
     
     // Handle button press (with debouncing)
-    bool current_button_state = digitalRead(ENCODER_SW_PIN);
+    bool current_button_state = Board::read<Board::EncoderSw>();
     unsigned long current_time = millis();
     
     // Check for button press (transition from HIGH to LOW)
-    if (last_button_state == HIGH && current_button_state == LOW) {
+    if (last_button_state == HIGH && current_button_state == LOW && !button_down) {
         // Check if enough time has passed since last press (debouncing)
         if (current_time - last_button_press_time > DEBOUNCE_DELAY) {
-            debug_print("Rotary encoder button pressed - toggle play/pause");
-            app.toggle_play_pause();
+            trace.submit(TRACE_BUTTON_DOWN);
+            button_down = true;
             last_button_press_time = current_time;
         }
     }
+
+    // A release only counts once the pin has stayed HIGH for the debounce
+    // delay, so contact bounce right after a press is not taken for one.
+    if (current_button_state == LOW) {
+        last_button_low_time = current_time;
+    } else if (button_down && current_time - last_button_low_time >= DEBOUNCE_DELAY) {
+        trace.submit(TRACE_BUTTON_UP);
+        button_down = false;
+    }
     
     last_button_state = current_button_state;
 }
\ No newline at end of file
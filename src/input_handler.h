@@ -1,32 +1,45 @@
 #pragma once
 
 #include "app.h"
-
-// Rotary encoder pins
-#define ENCODER_SW_PIN 15
-#define ENCODER_DT_PIN 16
-#define ENCODER_CLK_PIN 17
+#include "board.h"
+#include "event_trace.h"
+#include "rotary_decoder.h"
 
 class InputHandler {
 private:
     App& app;
+    EventTrace& trace;
     
     // Rotary encoder state tracking
     volatile bool rotation_detected;
     volatile bool clockwise;
     bool last_button_state;
+    bool button_down; // press submitted, release not yet
+    bool button_held;
+    bool scrubbed; // rotated while held, so the release is not a play/pause
     unsigned long last_button_press_time;
-    unsigned long last_rotation_time;
+    unsigned long last_button_low_time;
     static const unsigned long DEBOUNCE_DELAY = 50; // ms
-    static const unsigned long ROTATION_DEBOUNCE = 5; // ms
+    static const uint32_t ROTATION_DEBOUNCE = 5; // ms
+    RotaryDecoder<Board::EncoderClk, Board::EncoderDt, Board::ms_to_cycles(ROTATION_DEBOUNCE)> encoder;
+    static const int SCRUB_STEP = 10; // s per detent while the button is held
+    static const int KEY_SEEK_STEP = 30; // s
     
     // Static instance for interrupt handling
     static InputHandler* instance;
     static void IRAM_ATTR rotary_interrupt();
     
 public:
-    InputHandler(App& application);
+    InputHandler(App& application, EventTrace& event_trace);
     void initialize();
+
+    // Poll the inputs and submit what happened to the event trace.
     void handle_keyboard_input();
     void handle_rotary_encoder();
+
+    // Handlers the event trace dispatches to, live or replayed.
+    void on_key(char key);
+    void on_rotation(bool clockwise);
+    void on_button_down();
+    void on_button_up();
 };
\ No newline at end of file
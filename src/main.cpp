@@ -1,61 +1,172 @@
+#include "alloc_guard.h"
 #include "app.h"
+#include "board.h"
 #include "config.h"
 #include "debug.h"
 #include "display_manager.h"
+#include "event_trace.h"
 #include "hardware.h"
 #include "input_handler.h"
 #include "nfc_reader.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <Wire.h>
+#include <freertos/event_groups.h>
 
 const String CONF_PATH = "/config.yaml";
 
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+// With a USB host attached, give it a moment to open the port so boot logs are
+// not lost; without one, don't wait at all.
+static const unsigned long SERIAL_WAIT_TIMEOUT = 1500; // ms
+
+static const EventBits_t BOOT_SD_DONE = BIT0;
+
+static EventGroupHandle_t boot_events;
+static bool sd_ready = false;
+
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, Board::OLED_RESET);
 DisplayManager display_manager(&display);
+int dispatch_event(const TraceEvent& event);
+
 App app(display_manager);
-InputHandler input_handler(app);
+EventTrace event_trace(dispatch_event);
+InputHandler input_handler(app, event_trace);
 NFCReader nfc_reader;
 
+int dispatch_event(const TraceEvent& event) {
+    switch (event.type) {
+        case TRACE_NFC_TAP: {
+            const char* uid = (const char*)event.payload;
+            size_t uid_length = strnlen(uid, event.length);
+            UidString card_uid;
+            PathString ndef_path;
+            card_uid.append(uid, uid_length);
+            if (uid_length + 1 < event.length) {
+                ndef_path.append(uid + uid_length + 1, event.length - uid_length - 1);
+            }
+
+            debug_print("NFC Card detected: %s", card_uid.c_str());
+            if (!ndef_path.empty()) {
+                debug_print("NDEF track path: %s", ndef_path.c_str());
+            }
+            app.play(card_uid.c_str(), ndef_path.c_str());
+            break;
+        }
+        case TRACE_NFC_REMOVED:
+            debug_print("NFC Card removed");
+            break;
+        case TRACE_ENCODER_CW:
+        case TRACE_ENCODER_CCW:
+            input_handler.on_rotation(event.type == TRACE_ENCODER_CW);
+            break;
+        case TRACE_BUTTON_DOWN:
+            input_handler.on_button_down();
+            break;
+        case TRACE_BUTTON_UP:
+            input_handler.on_button_up();
+            break;
+        case TRACE_SERIAL_KEY:
+            input_handler.on_key(event.payload[0]);
+            break;
+        case TRACE_AUDIO_EOF:
+            app.on_song_finished();
+            break;
+        default:
+            break;
+    }
+    return app.get_state();
+}
+
 void handle_nfc() {
-    String card_uid = nfc_reader.poll_new_card();
-    if (card_uid.isEmpty()) {
+    if (nfc_reader.poll_card_removed()) {
+        event_trace.submit(TRACE_NFC_REMOVED);
+    }
+
+    CardTap tap = nfc_reader.poll_new_card();
+    if (tap.uid.empty()) {
         return;
     }
 
-    debug_print("NFC Card detected: %s", card_uid.c_str());
-    app.play(card_uid);
+    uint8_t payload[TraceEvent::MAX_PAYLOAD];
+    size_t length = min((size_t)tap.uid.length(), sizeof(payload) - 1);
+    memcpy(payload, tap.uid.c_str(), length);
+    payload[length++] = '\0';
+    size_t path_length = min((size_t)tap.ndef_path.length(), sizeof(payload) - length);
+    memcpy(payload + length, tap.ndef_path.c_str(), path_length);
+    event_trace.submit(TRACE_NFC_TAP, payload, length + path_length);
+}
+
+// micros() counts from reset, so this includes the ROM and bootloader time.
+void boot_phase(const char* phase) {
+    debug_print("Boot: %s at %lu ms", phase, micros() / 1000);
+}
+
+void wait_for_serial() {
+    if (!Serial.isPlugged()) {
+        return;
+    }
+    unsigned long start = millis();
+    while (!Serial && millis() - start < SERIAL_WAIT_TIMEOUT) {
+        delay(10);
+    }
+}
+
+// SD (FSPI) and the display (I2C) sit on their own buses, so they are brought up
+// on the other core while this one initialises NFC. Only the SD card gates
+// startup; the display is drawn on once it reports ready.
+void init_sd_task(void* param) {
+    sd_ready = Hardware::initialize_sd_card();
+    xEventGroupSetBits(boot_events, BOOT_SD_DONE);
+    vTaskDelete(nullptr);
+}
+
+void init_display_task(void* param) {
+    if (Hardware::initialize_display()) {
+        display_manager.set_ready();
+        boot_phase("display");
+    }
+    vTaskDelete(nullptr);
 }
 
 void setup() {
     Serial.begin(115200);
-    delay(3000);
+    wait_for_serial();
     debug_print("Starting up...");
+    boot_phase("serial");
 
-    if (!Hardware::initialize_sd_card()) {
-        return;
-    }
+    boot_events = xEventGroupCreate();
+    xTaskCreatePinnedToCore(init_sd_task, "init_sd", 4096, nullptr, 1, nullptr, 0);
+    xTaskCreatePinnedToCore(init_display_task, "init_display", 4096, nullptr, 1, nullptr, 0);
 
     Hardware::initialize_spi();
     nfc_reader.initialize(Hardware::spi_rc522);
     debug_print("RC522 initialized");
+    boot_phase("nfc");
+
+    input_handler.initialize();
+    pinMode(LED_BUILTIN, OUTPUT);
 
-    if (!Hardware::initialize_display()) {
+    xEventGroupWaitBits(boot_events, BOOT_SD_DONE, pdFALSE, pdTRUE, portMAX_DELAY);
+    vEventGroupDelete(boot_events);
+    boot_phase("sd");
+
+    if (!sd_ready) {
         return;
     }
 
+    // Config and artwork are loaded in the background; taps arriving before
+    // that are held until the config is in.
     app.setup();
-    
-    input_handler.initialize();
-
-    pinMode(LED_BUILTIN, OUTPUT);
+    boot_phase("tap-ready");
     debug_print("Ready!");
+    AllocGuard::watch_current_task(); // setup() and loop() share the task
 }
 
 void loop() {
     input_handler.handle_keyboard_input();
     input_handler.handle_rotary_encoder();
     handle_nfc();
+    event_trace.loop();
     app.loop();
     vTaskDelay(1);
 }
@@ -64,7 +175,12 @@ void audio_info(const char *info) {
     debug_print("Audio info: %s", info);
 }
 
+void audio_process_i2s(uint32_t *sample, bool *continueI2S) {
+    app.process_output((int16_t *)sample);
+    *continueI2S = true;
+}
+
 void audio_eof_mp3(const char *info) {
     debug_print("Audio finished: %s", info);
-    app.on_song_finished();
+    event_trace.submit(TRACE_AUDIO_EOF);
 }
\ No newline at end of file
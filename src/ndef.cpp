@@ -0,0 +1,111 @@
+#include "ndef.h"
+
+static const uint8_t TLV_NULL = 0x00;
+static const uint8_t TLV_NDEF_MESSAGE = 0x03;
+static const uint8_t TLV_TERMINATOR = 0xFE;
+
+static const uint8_t URI_PREFIX_NONE = 0x00;
+static const uint8_t URI_PREFIX_FILE = 0x1D; // "file://"
+
+NdefScan find_ndef_message(const uint8_t* data, size_t length, size_t* offset, size_t* message_length) {
+    size_t p = 0;
+    while (p < length) {
+        uint8_t tag = data[p];
+        if (tag == TLV_NULL) {
+            p++;
+            continue;
+        }
+        if (tag == TLV_TERMINATOR) {
+            return NDEF_ABSENT;
+        }
+        if (p + 1 >= length) {
+            return NDEF_NEED_MORE;
+        }
+        size_t value_length = data[p + 1];
+        size_t header_length = 2;
+        if (value_length == 0xFF) {
+            if (p + 3 >= length) {
+                return NDEF_NEED_MORE;
+            }
+            value_length = (data[p + 2] << 8) | data[p + 3];
+            header_length = 4;
+        }
+        if (tag == TLV_NDEF_MESSAGE) {
+            *offset = p + header_length;
+            *message_length = value_length;
+            return *offset + value_length <= length ? NDEF_FOUND : NDEF_NEED_MORE;
+        }
+        p += header_length + value_length;
+    }
+    return NDEF_NEED_MORE;
+}
+
+PathString parse_ndef_path(const uint8_t* message, size_t length) {
+    if (length < 3) {
+        return "";
+    }
+
+    uint8_t header = message[0];
+    bool short_record = header & 0x10;
+    bool has_id = header & 0x08;
+    if ((header & 0x07) != 0x01) { // TNF: NFC Forum well-known type
+        return "";
+    }
+
+    size_t p = 1;
+    uint8_t type_length = message[p++];
+    size_t payload_length;
+    if (short_record) {
+        payload_length = message[p++];
+    } else {
+        if (p + 4 > length) {
+            return "";
+        }
+        payload_length = ((uint32_t)message[p] << 24) | ((uint32_t)message[p + 1] << 16) |
+                         ((uint32_t)message[p + 2] << 8) | message[p + 3];
+        p += 4;
+    }
+    uint8_t id_length = 0;
+    if (has_id) {
+        if (p >= length) {
+            return "";
+        }
+        id_length = message[p++];
+    }
+    // Compared against what is left rather than summed: a long record's 32-bit
+    // length would wrap a sum on the device and pass.
+    if (type_length != 1 || (size_t)type_length + id_length > length - p) {
+        return "";
+    }
+    if (payload_length < 1 || payload_length > length - p - type_length - id_length) {
+        return "";
+    }
+
+    char type = message[p];
+    const uint8_t* payload = message + p + type_length + id_length;
+
+    const uint8_t* text = nullptr;
+    size_t text_length = 0;
+    if (type == 'T') {
+        uint8_t status = payload[0];
+        size_t lang_length = status & 0x3F;
+        if ((status & 0x80) || 1 + lang_length > payload_length) { // UTF-16 text unsupported
+            return "";
+        }
+        text = payload + 1 + lang_length;
+        text_length = payload_length - 1 - lang_length;
+    } else if (type == 'U') {
+        if (payload[0] != URI_PREFIX_NONE && payload[0] != URI_PREFIX_FILE) {
+            return "";
+        }
+        text = payload + 1;
+        text_length = payload_length - 1;
+    } else {
+        return "";
+    }
+
+    PathString path;
+    path.append((const char*)text, text_length);
+    path.trim();
+    return path;
+}
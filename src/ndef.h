@@ -0,0 +1,24 @@
+#pragma once
+
+#include "fixed_string.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Parsing of the NDEF data a card carries, kept apart from the reader so it
+// can be checked against crafted and malformed data off the device
+// (test/test_ndef). Everything here treats the card's bytes as untrusted.
+
+enum NdefScan {
+    NDEF_FOUND,
+    NDEF_NEED_MORE,
+    NDEF_ABSENT,
+};
+
+// Locates the NDEF message TLV in the first `length` bytes of the card's data
+// area. On NDEF_FOUND the message lies entirely within them.
+NdefScan find_ndef_message(const uint8_t* data, size_t length, size_t* offset, size_t* message_length);
+
+// Takes the first record of the message if it is a well-known Text ("T") or URI
+// ("U") record. URIs are only accepted without a prefix or with "file://", so a
+// card written with a web link is not mistaken for a track. "" otherwise.
+PathString parse_ndef_path(const uint8_t* message, size_t length);
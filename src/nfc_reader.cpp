@@ -1,32 +1,103 @@
 #include "nfc_reader.h"
+#include "board.h"
+#include "debug.h"
+#include "ndef.h"
+
+// NFC Forum key protecting NDEF sectors on MIFARE Classic cards.
+static const byte NDEF_SECTOR_KEY[MFRC522::MF_KEY_SIZE] = {0xD3, 0xF7, 0xD3, 0xF7, 0xD3, 0xF7};
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
 
 NFCReader::NFCReader()
-    : mfrc522(SS2, RST_PIN), card_present(false), absence_count(0),
+    : mfrc522(SS2, Board::NfcReset::number), card_present(false), removal_pending(false), absence_count(0),
       last_presence_check(0) {}
 
 void NFCReader::initialize(SPIClass* spi) {
     spi->begin(SCK2, MISO2, MOSI2, SS2);
     SPI = *spi;
-    mfrc522.PCD_Init(SS2, RST_PIN);
+    mfrc522.PCD_Init(SS2, Board::NfcReset::number);
 }
 
 bool NFCReader::is_card_present() {
     return mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial();
 }
 
-String NFCReader::get_card_uid() {
-    String uid = "";
+UidString NFCReader::get_card_uid() {
+    UidString uid;
     for (byte i = 0; i < mfrc522.uid.size; i++) {
-        if (uid != "") uid += ":";
-        if (mfrc522.uid.uidByte[i] < 0x10) uid += "0";
-        uid += String(mfrc522.uid.uidByte[i], HEX);
+        if (i > 0) uid += ':';
+        uid += HEX_DIGITS[mfrc522.uid.uidByte[i] >> 4];
+        uid += HEX_DIGITS[mfrc522.uid.uidByte[i] & 0x0F];
     }
-    uid.toUpperCase();
     return uid;
 }
 
 void NFCReader::halt_card() {
     mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1(); // in case an NDEF read authenticated a sector
+}
+
+// Reads the index-th 16 byte chunk of the card's NDEF data area: from page 4 on
+// NTAG/Ultralight, from sector 1 on (skipping sector trailers) on MIFARE Classic.
+bool NFCReader::read_ndef_block(MFRC522::PICC_Type type, byte index, byte* out) {
+    byte buffer[18];
+    byte size = sizeof(buffer);
+    byte address;
+
+    if (type == MFRC522::PICC_TYPE_MIFARE_UL) {
+        address = 4 + index * 4;
+    } else {
+        byte sector = 1 + index / 3;
+        address = sector * 4 + index % 3;
+        if (index % 3 == 0) {
+            MFRC522::MIFARE_Key key;
+            memcpy(key.keyByte, NDEF_SECTOR_KEY, sizeof(NDEF_SECTOR_KEY));
+            if (mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, sector * 4 + 3, &key,
+                                         &mfrc522.uid) != MFRC522::STATUS_OK) {
+                return false;
+            }
+        }
+    }
+
+    if (mfrc522.MIFARE_Read(address, buffer, &size) != MFRC522::STATUS_OK) {
+        return false;
+    }
+    memcpy(out, buffer, 16);
+    return true;
+}
+
+PathString NFCReader::read_ndef_path() {
+    MFRC522::PICC_Type type = mfrc522.PICC_GetType(mfrc522.uid.sak);
+    if (type != MFRC522::PICC_TYPE_MIFARE_UL && type != MFRC522::PICC_TYPE_MIFARE_MINI &&
+        type != MFRC522::PICC_TYPE_MIFARE_1K && type != MFRC522::PICC_TYPE_MIFARE_4K) {
+        return "";
+    }
+
+    byte data[MAX_NDEF_BYTES];
+    size_t length = 0;
+    size_t offset = 0;
+    size_t message_length = 0;
+    unsigned long start = millis();
+
+    while (true) {
+        NdefScan scan = find_ndef_message(data, length, &offset, &message_length);
+        if (scan == NDEF_FOUND) {
+            break;
+        }
+        if (scan == NDEF_ABSENT || length + 16 > MAX_NDEF_BYTES) {
+            return "";
+        }
+        if (millis() - start > NDEF_READ_BUDGET) {
+            debug_print("NDEF read budget exceeded after %d bytes", length);
+            return "";
+        }
+        if (!read_ndef_block(type, length / 16, data + length)) {
+            return "";
+        }
+        length += 16;
+    }
+
+    return parse_ndef_path(data + offset, message_length);
 }
 
 // A halted card ignores REQA, so we wake it with WUPA to confirm it is still
@@ -48,35 +119,44 @@ bool NFCReader::is_card_still_present() {
     return false;
 }
 
-String NFCReader::poll_new_card() {
+CardTap NFCReader::poll_new_card() {
     if (card_present) {
         unsigned long now = millis();
         if (now - last_presence_check < PRESENCE_CHECK_INTERVAL) {
-            return ""; // not time to re-probe; assume still present
+            return {}; // not time to re-probe; assume still present
         }
         last_presence_check = now;
 
         if (is_card_still_present()) {
             absence_count = 0;
-            return "";
+            return {};
         }
         // Tolerate a few misses while the card is being lifted through the
         // weak edge of the field before declaring it removed.
         if (++absence_count < ABSENCE_THRESHOLD) {
-            return "";
+            return {};
         }
         card_present = false;
+        removal_pending = true;
         absence_count = 0;
-        return "";
+        return {};
     }
 
     if (is_card_present()) {
-        String uid = get_card_uid();
+        CardTap tap;
+        tap.uid = get_card_uid();
+        tap.ndef_path = read_ndef_path(); // same session, before the card is halted
         halt_card(); // silence the card so it won't re-trigger while it sits
         card_present = true;
         absence_count = 0;
         last_presence_check = millis();
-        return uid;
+        return tap;
     }
-    return "";
+    return {};
+}
+
+bool NFCReader::poll_card_removed() {
+    bool removed = removal_pending;
+    removal_pending = false;
+    return removed;
 }
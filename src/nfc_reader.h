@@ -1,9 +1,13 @@
 #pragma once
 
+#include "fixed_string.h"
 #include <Arduino.h>
 #include <MFRC522.h>
 
-#define RST_PIN 2
+struct CardTap {
+    UidString uid;
+    PathString ndef_path; // track path stored on the card, "" if it carries none
+};
 
 class NFCReader {
 private:
@@ -12,6 +16,7 @@ private:
     // Presence tracking, so a card sitting on (or being lifted off) the reader
     // is not mistaken for a fresh tap.
     bool card_present;
+    bool removal_pending;
     byte absence_count;
     unsigned long last_presence_check;
 
@@ -21,16 +26,26 @@ private:
     static const unsigned long PRESENCE_CHECK_INTERVAL = 200; // ms
     static const byte ABSENCE_THRESHOLD = 3;                  // consecutive misses
 
+    // NDEF reads happen inside the tap, so cap both how much of the card we
+    // read and how long we spend on it; a path never needs more than this.
+    static const size_t MAX_NDEF_BYTES = 144;                 // 9 blocks of 16
+    static const unsigned long NDEF_READ_BUDGET = 40;         // ms
+
     bool is_card_still_present();
+    bool read_ndef_block(MFRC522::PICC_Type type, byte index, byte* out);
+    PathString read_ndef_path();
 
 public:
     NFCReader();
     void initialize(SPIClass* spi);
     bool is_card_present();
-    String get_card_uid();
+    UidString get_card_uid();
     void halt_card();
 
-    // Returns the UID of a newly presented card, or "" when nothing new happened
-    // (no card, or the same card is still on / leaving the reader).
-    String poll_new_card();
+    // Returns the UID (and NDEF track path, if any) of a newly presented card.
+    // The UID is "" when nothing new happened (no card, or the same card is
+    // still on / leaving the reader).
+    CardTap poll_new_card();
+    // True once after the card seen by poll_new_card() has left the reader.
+    bool poll_card_removed();
 };
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "board.h"
+
+// Turns falling CLK edges of a quadrature encoder into steps, from a single
+// snapshot of the input bank and a cycle-count timestamp. Edges closer than
+// the debounce interval are contact bounce. Plain logic over Pin types, so the
+// ISR timing behaviour is tested against FakeGpio off the device
+// (test/test_rotary_decoder).
+//
+// The cycle counter wraps every ~18 s at 240 MHz; an edge landing within the
+// debounce window of a wrapped timestamp is dropped, one detent at worst.
+template <class Clk, class Dt, uint32_t DebounceCycles>
+class RotaryDecoder {
+private:
+    static_assert(Clk::bank == Dt::bank, "CLK and DT must be readable in one access");
+
+    uint32_t last_edge;
+    bool seen_edge;
+
+public:
+    RotaryDecoder() : last_edge(0), seen_edge(false) {}
+
+    // Returns 1 for a clockwise step, -1 for counter-clockwise, 0 to ignore.
+    BOARD_INLINE int on_edge(uint32_t bank_bits, uint32_t now) {
+        if (seen_edge && now - last_edge < DebounceCycles) {
+            return 0;
+        }
+        if (Clk::in(bank_bits)) {
+            return 0; // only the falling edge completes a step
+        }
+        last_edge = now;
+        seen_edge = true;
+        return Dt::in(bank_bits) ? 1 : -1;
+    }
+};
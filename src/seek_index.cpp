@@ -0,0 +1,236 @@
+#include "seek_index.h"
+#include "debug.h"
+
+// MPEG audio layer III bitrates in kbit/s, by bitrate index.
+static const uint16_t BITRATES_V1[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+static const uint16_t BITRATES_V2[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+static const uint32_t SAMPLE_RATES_V1[4] = {44100, 48000, 32000, 0};
+
+struct FrameInfo {
+    uint32_t length;
+    uint32_t samples;
+    uint32_t sample_rate;
+};
+
+static bool parse_frame_header(const uint8_t* h, FrameInfo* info) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+    byte version = (h[1] >> 3) & 0x03; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+    byte layer = (h[1] >> 1) & 0x03;   // 1: layer III
+    byte bitrate_index = h[2] >> 4;
+    byte rate_index = (h[2] >> 2) & 0x03;
+    byte padding = (h[2] >> 1) & 0x01;
+    if (version == 1 || layer != 1 || rate_index == 3) {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+    uint32_t bitrate = (mpeg1 ? BITRATES_V1 : BITRATES_V2)[bitrate_index] * 1000;
+    if (bitrate == 0) {
+        return false; // free-format or invalid
+    }
+    info->sample_rate = SAMPLE_RATES_V1[rate_index] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    info->samples = mpeg1 ? 1152 : 576;
+    info->length = (mpeg1 ? 144 : 72) * bitrate / info->sample_rate + padding;
+    return true;
+}
+
+SeekIndex::SeekIndex() : interval(DEFAULT_INTERVAL), file_size(0) {
+    offsets.reserve(MAX_ENTRIES);
+}
+
+PathString SeekIndex::sidecar_path(const char* track_path) {
+    PathString path = track_path;
+    path += ".idx";
+    return path;
+}
+
+bool SeekIndex::load(Storage& storage, const char* track_path, uint32_t track_size) {
+    clear();
+
+    if (track_size == 0) {
+        StorageFile track = storage.open(track_path, STORAGE_INDEX);
+        if (!track) {
+            return false;
+        }
+        track_size = track.size();
+    }
+
+    StorageFile file = storage.open(sidecar_path(track_path).c_str(), STORAGE_INDEX);
+    if (!file) {
+        return false;
+    }
+
+    Header header;
+    bool ok = file.read(&header, sizeof(header)) == sizeof(header) &&
+              header.magic == MAGIC && header.version == VERSION &&
+              header.interval > 0 && header.file_size == track_size && header.count <= MAX_ENTRIES;
+    if (ok) {
+        offsets.resize(header.count);
+        size_t bytes = header.count * sizeof(uint32_t);
+        ok = file.read(offsets.data(), bytes) == bytes;
+    }
+    file.close();
+
+    if (!ok) {
+        debug_print("Stale or invalid seek index for %s", track_path);
+        clear();
+        return false;
+    }
+    interval = header.interval;
+    file_size = header.file_size;
+    return true;
+}
+
+bool SeekIndex::save(Storage& storage, const char* track_path) const {
+    StorageFile file = storage.open(sidecar_path(track_path).c_str(), STORAGE_INDEX, true);
+    if (!file) {
+        return false;
+    }
+
+    Header header = {MAGIC, VERSION, interval, file_size, (uint32_t)offsets.size()};
+    size_t bytes = offsets.size() * sizeof(uint32_t);
+    bool ok = file.write(&header, sizeof(header)) == sizeof(header) &&
+              file.write(offsets.data(), bytes) == bytes;
+    return file.close() && ok;
+}
+
+void SeekIndex::clear() {
+    offsets.clear();
+    interval = DEFAULT_INTERVAL;
+    file_size = 0;
+}
+
+bool SeekIndex::is_loaded() const {
+    return !offsets.empty();
+}
+
+uint32_t SeekIndex::offset_for(uint32_t seconds) const {
+    if (offsets.empty()) {
+        return 0;
+    }
+    size_t i = min((size_t)(seconds / interval), offsets.size() - 1);
+    return offsets[i];
+}
+
+uint32_t SeekIndex::seconds_at(uint32_t offset) const {
+    if (offsets.empty()) {
+        return 0;
+    }
+    // Last entry at or before offset.
+    size_t lo = 0;
+    size_t hi = offsets.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (offsets[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo * interval;
+}
+
+uint32_t SeekIndex::duration() const {
+    return offsets.size() * interval;
+}
+
+// Keeps every other entry at twice the interval, making room for as many
+// entries again.
+void SeekIndex::coarsen() {
+    for (size_t i = 0; i * 2 < offsets.size(); i++) {
+        offsets[i] = offsets[i * 2];
+    }
+    offsets.resize((offsets.size() + 1) / 2);
+    interval *= 2;
+}
+
+SeekIndexBuilder::SeekIndexBuilder() : storage(nullptr), pos(0), samples(0), sample_rate(0) {}
+
+bool SeekIndexBuilder::begin(Storage& target, const char* path) {
+    file.close();
+    file = target.open(path, STORAGE_INDEX);
+    if (!file) {
+        debug_print("Seek index: cannot open %s", path);
+        return false;
+    }
+
+    storage = &target;
+    track_path = path;
+    index.clear();
+    index.file_size = file.size();
+    pos = 0;
+    samples = 0;
+    sample_rate = 0;
+    skip_id3v2();
+    debug_print("Seek index: scanning %s", path);
+    return true;
+}
+
+bool SeekIndexBuilder::is_active() const {
+    return (bool)file;
+}
+
+const PathString& SeekIndexBuilder::track() const {
+    return track_path;
+}
+
+bool SeekIndexBuilder::read_at(uint32_t offset, uint8_t* dst, size_t length) {
+    return file.seek(offset) && file.read(dst, length) == length;
+}
+
+void SeekIndexBuilder::skip_id3v2() {
+    uint8_t tag[10];
+    if (!read_at(0, tag, sizeof(tag)) || memcmp(tag, "ID3", 3) != 0) {
+        return;
+    }
+    uint32_t size = ((tag[6] & 0x7F) << 21) | ((tag[7] & 0x7F) << 14) |
+                    ((tag[8] & 0x7F) << 7) | (tag[9] & 0x7F);
+    bool has_footer = tag[5] & 0x10;
+    pos = 10 + size + (has_footer ? 10 : 0);
+}
+
+void SeekIndexBuilder::finish(bool ok) {
+    file.close();
+    if (ok && index.is_loaded() && index.save(*storage, track_path.c_str())) {
+        debug_print("Seek index: %s done, %d entries", track_path.c_str(), index.offsets.size());
+    } else {
+        debug_print("Seek index: giving up on %s", track_path.c_str());
+    }
+    index.clear();
+}
+
+bool SeekIndexBuilder::step(size_t byte_budget) {
+    if (!file) {
+        return true;
+    }
+
+    uint32_t end = pos + byte_budget;
+    while (pos < end) {
+        uint8_t header[4];
+        if (pos + 4 > index.file_size || !read_at(pos, header, sizeof(header))) {
+            finish(true);
+            return true;
+        }
+
+        FrameInfo frame;
+        if (!parse_frame_header(header, &frame) ||
+            (sample_rate != 0 && frame.sample_rate != sample_rate)) {
+            pos++; // lost sync (or hit a trailing tag), resynchronise byte by byte
+            continue;
+        }
+        sample_rate = frame.sample_rate;
+
+        uint64_t next_entry = (uint64_t)index.offsets.size() * index.interval;
+        if (samples >= next_entry * sample_rate) {
+            if (index.offsets.size() == SeekIndex::MAX_ENTRIES) {
+                index.coarsen(); // next_entry stays put, now at half the count
+            }
+            index.offsets.push_back(pos);
+        }
+        samples += frame.samples;
+        pos += frame.length;
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "fixed_string.h"
+#include "storage.h"
+#include <Arduino.h>
+#include <vector>
+
+// Maps playback time to byte offsets in an MP3 at fixed intervals, so seeking
+// (even in VBR files) is a table lookup instead of a scan from the start.
+// Cached in a sidecar next to the track: `x.mp3` -> `x.mp3.idx`.
+class SeekIndex {
+private:
+    static const uint32_t MAGIC = 0x49535054; // "TPSI"
+    static const uint16_t VERSION = 1;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t interval;  // seconds between entries
+        uint32_t file_size; // of the track, to notice a replaced file
+        uint32_t count;
+    };
+
+    // offsets[i]: first frame at or after i * interval. Reserved up front, so
+    // loading or building an index on a tap never allocates. Tracks too long
+    // for MAX_ENTRIES at the default interval get a coarser one.
+    std::vector<uint32_t> offsets;
+    uint16_t interval;
+    uint32_t file_size;
+
+    void coarsen();
+
+    friend class SeekIndexBuilder;
+
+public:
+    static const uint16_t DEFAULT_INTERVAL = 5; // s
+    static const uint32_t MAX_ENTRIES = 2880;   // 4 h at the default interval, then it doubles
+
+    SeekIndex();
+
+    static PathString sidecar_path(const char* track_path);
+
+    // track_size, when known, saves opening the track to validate the sidecar.
+    bool load(Storage& storage, const char* track_path, uint32_t track_size = 0);
+    bool save(Storage& storage, const char* track_path) const;
+    void clear();
+    bool is_loaded() const;
+
+    uint32_t offset_for(uint32_t seconds) const;
+    uint32_t seconds_at(uint32_t offset) const;
+    uint32_t duration() const;
+};
+
+// Builds a SeekIndex by walking MP3 frame headers, a bounded number of bytes at
+// a time so it can run in idle slices of the main loop. The header reads hop
+// forward frame by frame, which the storage read-ahead turns into large reads.
+class SeekIndexBuilder {
+private:
+    Storage* storage;
+    StorageFile file;
+    PathString track_path;
+    SeekIndex index;
+    uint32_t pos;            // offset of the next expected frame header
+    uint64_t samples;        // decoded samples before pos
+    uint32_t sample_rate;
+
+    bool read_at(uint32_t offset, uint8_t* dst, size_t length);
+    void skip_id3v2();
+    void finish(bool ok);
+
+public:
+    SeekIndexBuilder();
+
+    bool begin(Storage& storage, const char* track_path);
+    // Scans up to byte_budget bytes of the track. Returns true once the index
+    // is complete and saved, or the scan has been abandoned.
+    bool step(size_t byte_budget);
+    bool is_active() const;
+    const PathString& track() const;
+};
\ No newline at end of file
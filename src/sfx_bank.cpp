@@ -0,0 +1,228 @@
+#include "sfx_bank.h"
+#include "debug.h"
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static int16_t saturate16(int32_t v) {
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return v;
+}
+
+SfxBank::SfxBank() : next_voice(0), output_rate(44100), gain(32767) {
+    for (auto& clip : clips) {
+        clip = {nullptr, 0, 0};
+    }
+    stop_all();
+}
+
+bool SfxBank::load(SfxId id, Storage& storage, const char* path) {
+    StorageFile file = storage.open(path, STORAGE_SFX);
+    if (!file) {
+        debug_print("SFX not found: %s", path);
+        return false;
+    }
+
+    uint8_t header[12];
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+        debug_print("SFX is not a WAV file: %s", path);
+        file.close();
+        return false;
+    }
+
+    uint16_t channels = 0;
+    uint16_t bits_per_sample = 0;
+    uint32_t sample_rate = 0;
+    uint32_t data_size = 0;
+
+    // Walk the RIFF chunks until "data"; "fmt " must come before it.
+    uint8_t chunk[8];
+    while (file.read(chunk, sizeof(chunk)) == sizeof(chunk)) {
+        uint32_t chunk_size = read_u32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (chunk_size < sizeof(fmt) || file.read(fmt, sizeof(fmt)) != sizeof(fmt)) {
+                break;
+            }
+            uint16_t audio_format = read_u16(fmt);
+            channels = read_u16(fmt + 2);
+            sample_rate = read_u32(fmt + 4);
+            bits_per_sample = read_u16(fmt + 14);
+            if (audio_format != 1) {
+                channels = 0; // not plain PCM
+            }
+            if (!file.seek(file.position() + chunk_size - sizeof(fmt) + (chunk_size & 1))) {
+                break;
+            }
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            data_size = chunk_size;
+            break;
+        } else {
+            if (!file.seek(file.position() + chunk_size + (chunk_size & 1))) {
+                break;
+            }
+        }
+    }
+
+    if (channels < 1 || channels > 2 || bits_per_sample != 16 || sample_rate == 0 || data_size == 0) {
+        debug_print("Unsupported SFX format (need 16-bit PCM, mono/stereo): %s", path);
+        file.close();
+        return false;
+    }
+
+    uint32_t frame_bytes = channels * 2;
+    uint32_t length = data_size / frame_bytes;
+    if (length * 2 > MAX_CLIP_BYTES) {
+        length = MAX_CLIP_BYTES / 2;
+        debug_print("SFX truncated to %u samples: %s", length, path);
+    }
+
+    int16_t* samples = (int16_t*)(psramFound() ? ps_malloc(length * 2) : malloc(length * 2));
+    if (!samples) {
+        debug_print("Out of memory loading SFX: %s", path);
+        file.close();
+        return false;
+    }
+
+    uint8_t buffer[512];
+    uint32_t decoded = 0;
+    while (decoded < length) {
+        size_t want = min((size_t)((length - decoded) * frame_bytes), sizeof(buffer) / frame_bytes * frame_bytes);
+        size_t got = file.read(buffer, want);
+        uint32_t frames = got / frame_bytes;
+        if (frames == 0) {
+            break;
+        }
+        for (uint32_t i = 0; i < frames; i++) {
+            const uint8_t* p = buffer + i * frame_bytes;
+            int32_t s = (int16_t)read_u16(p);
+            if (channels == 2) {
+                s = (s + (int16_t)read_u16(p + 2)) >> 1;
+            }
+            samples[decoded++] = s;
+        }
+    }
+    file.close();
+
+    // A clip may be replaced while a voice still points at it.
+    for (auto& voice : voices) {
+        if (voice.clip == &clips[id]) {
+            voice.clip = nullptr;
+        }
+    }
+    free(clips[id].samples);
+    clips[id] = {samples, decoded, sample_rate};
+
+    debug_print("SFX loaded: %s (%u samples @ %u Hz)", path, decoded, sample_rate);
+    return decoded > 0;
+}
+
+bool SfxBank::is_loaded(SfxId id) const {
+    return clips[id].samples != nullptr && clips[id].length > 0;
+}
+
+bool SfxBank::is_active() const {
+    for (const auto& voice : voices) {
+        if (voice.clip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t SfxBank::compute_step(uint32_t clip_rate, uint32_t out_rate) {
+    return (uint32_t)(((uint64_t)clip_rate << 16) / out_rate);
+}
+
+bool SfxBank::play(SfxId id) {
+    if (!is_loaded(id)) {
+        return false;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < MAX_VOICES; i++) {
+        if (!voices[i].clip) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        slot = next_voice;
+    }
+    next_voice = (slot + 1) % MAX_VOICES;
+
+    voices[slot] = {&clips[id], 0, 0, compute_step(clips[id].sample_rate, output_rate)};
+    return true;
+}
+
+void SfxBank::stop_all() {
+    for (auto& voice : voices) {
+        voice = {nullptr, 0, 0, 0};
+    }
+}
+
+void SfxBank::set_output_rate(uint32_t rate) {
+    if (rate == 0 || rate == output_rate) {
+        return;
+    }
+    output_rate = rate;
+    for (auto& voice : voices) {
+        if (voice.clip) {
+            voice.step = compute_step(voice.clip->sample_rate, output_rate);
+        }
+    }
+}
+
+uint32_t SfxBank::get_output_rate() const {
+    return output_rate;
+}
+
+void SfxBank::set_gain(int32_t gain_q15) {
+    gain = constrain(gain_q15, 0, 32767);
+}
+
+// Nearest-sample resampling: plenty for UI blips, and keeps every voice to a
+// load, an add and a compare per frame.
+int32_t SfxBank::next_sample() {
+    int32_t acc = 0;
+    for (auto& voice : voices) {
+        if (!voice.clip) {
+            continue;
+        }
+        acc += voice.clip->samples[voice.index];
+        voice.frac += voice.step;
+        voice.index += voice.frac >> 16;
+        voice.frac &= 0xFFFF;
+        if (voice.index >= voice.clip->length) {
+            voice.clip = nullptr;
+        }
+    }
+    return (int32_t)(((int64_t)acc * gain) >> 15);
+}
+
+void SfxBank::mix(int16_t* frame) {
+    int32_t s = next_sample();
+    if (s == 0) {
+        return;
+    }
+    frame[0] = saturate16(frame[0] + s);
+    frame[1] = saturate16(frame[1] + s);
+}
+
+size_t SfxBank::render(int16_t* frames, size_t max_frames) {
+    size_t n = 0;
+    while (n < max_frames && is_active()) {
+        int16_t s = saturate16(next_sample());
+        frames[2 * n] = s;
+        frames[2 * n + 1] = s;
+        n++;
+    }
+    return n;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include "storage.h"
+
+enum SfxId {
+    SFX_UNKNOWN_CARD,
+    SFX_CLICK,
+    SFX_COUNT,
+};
+
+// Short UI sound effects, decoded to PCM once at boot and kept in RAM. They are
+// layered over the decoder's output one frame at a time, so triggering one never
+// touches the SD card or interrupts the current stream.
+class SfxBank {
+private:
+    struct Clip {
+        int16_t* samples;     // mono PCM
+        uint32_t length;      // in samples
+        uint32_t sample_rate;
+    };
+
+    struct Voice {
+        const Clip* clip;     // nullptr when the voice is free
+        uint32_t index;       // into clip->samples
+        uint32_t frac;        // Q16 fractional part of the read position
+        uint32_t step;        // Q16.16 advance per output frame
+    };
+
+    // Keeps the per-frame mixing cost bounded no matter how fast effects are
+    // triggered; the oldest voice is stolen when all are busy.
+    static const int MAX_VOICES = 4;
+    static const uint32_t MAX_CLIP_BYTES = 256 * 1024;
+
+    Clip clips[SFX_COUNT];
+    Voice voices[MAX_VOICES];
+    int next_voice;
+    uint32_t output_rate;
+    int32_t gain; // Q15
+
+    static uint32_t compute_step(uint32_t clip_rate, uint32_t out_rate);
+    int32_t next_sample();
+
+public:
+    SfxBank();
+
+    // Decodes a 16-bit PCM WAV file into RAM. Stereo clips are downmixed.
+    bool load(SfxId id, Storage& storage, const char* path);
+    bool is_loaded(SfxId id) const;
+    bool is_active() const;
+
+    bool play(SfxId id);
+    void stop_all();
+
+    void set_output_rate(uint32_t rate);
+    uint32_t get_output_rate() const;
+    void set_gain(int32_t gain_q15);
+
+    // Adds the active voices onto one interleaved stereo frame in place.
+    void mix(int16_t* frame);
+    // Renders active voices alone into interleaved stereo frames, for when no
+    // stream is feeding the output. Returns the number of frames written.
+    size_t render(int16_t* frames, size_t max_frames);
+};
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "storage.h"
+#include <string.h>
+
+uint8_t Storage::pool[POOL_BUFFERS][BUFFER_SIZE] __attribute__((aligned(4)));
+std::atomic<bool> Storage::pool_used[POOL_BUFFERS];
+std::atomic<uint32_t> Storage::stat_bytes[STORAGE_CONSUMERS];
+std::atomic<uint32_t> Storage::stat_calls[STORAGE_CONSUMERS];
+std::atomic<uint32_t> Storage::stat_busy_us[STORAGE_CONSUMERS];
+
+static const char* CONSUMER_NAMES[STORAGE_CONSUMERS] = {
+    "config", "artwork", "audio", "sfx", "index", "trace",
+};
+
+uint8_t* Storage::acquire_buffer(int* slot) {
+    for (int i = 0; i < POOL_BUFFERS; i++) {
+        bool expected = false;
+        if (pool_used[i].compare_exchange_strong(expected, true)) {
+            *slot = i;
+            return pool[i];
+        }
+    }
+    *slot = -1;
+    return nullptr; // pool exhausted; the file works unbuffered
+}
+
+void Storage::release_buffer(int slot) {
+    if (slot >= 0) {
+        pool_used[slot] = false;
+    }
+}
+
+StorageFile Storage::open(const char* path, StorageConsumer consumer, bool write) {
+    StorageFile file;
+    stat_calls[consumer]++;
+    int handle = backend_open(path, write);
+    if (handle < 0) {
+        return file;
+    }
+
+    file.storage = this;
+    file.handle = handle;
+    file.consumer = consumer;
+    file.writing = write;
+    file.file_size = write ? 0 : backend_size(handle);
+    file.buffer = acquire_buffer(&file.buffer_slot);
+    return file;
+}
+
+bool Storage::exists(const char* path, StorageConsumer consumer) {
+    stat_calls[consumer]++;
+    return backend_exists(path);
+}
+
+size_t Storage::timed_read(StorageConsumer consumer, int handle, uint32_t offset, void* dst, size_t length) {
+    uint32_t start = clock_us();
+    size_t n = backend_read(handle, offset, dst, length);
+    account(consumer, n, 1, clock_us() - start);
+    return n;
+}
+
+size_t Storage::timed_write(StorageConsumer consumer, int handle, const void* src, size_t length) {
+    uint32_t start = clock_us();
+    size_t n = backend_write(handle, src, length);
+    account(consumer, n, 1, clock_us() - start);
+    return n;
+}
+
+StorageStats Storage::stats(StorageConsumer consumer) {
+    return {stat_bytes[consumer], stat_calls[consumer], stat_busy_us[consumer]};
+}
+
+const char* Storage::consumer_name(StorageConsumer consumer) {
+    return CONSUMER_NAMES[consumer];
+}
+
+void Storage::account(StorageConsumer consumer, uint32_t bytes, uint32_t calls, uint32_t busy_us) {
+    stat_bytes[consumer] += bytes;
+    stat_calls[consumer] += calls;
+    stat_busy_us[consumer] += busy_us;
+}
+
+StorageFile::StorageFile()
+    : storage(nullptr), handle(-1), consumer(STORAGE_CONFIG), writing(false), file_size(0), pos(0),
+      buffer(nullptr), buffer_slot(-1), buffer_start(0), buffer_length(0), window(Storage::MIN_WINDOW),
+      failed(false) {}
+
+StorageFile::~StorageFile() {
+    close();
+}
+
+StorageFile::StorageFile(StorageFile&& other) : StorageFile() {
+    *this = static_cast<StorageFile&&>(other);
+}
+
+StorageFile& StorageFile::operator=(StorageFile&& other) {
+    if (this != &other) {
+        close();
+        storage = other.storage;
+        handle = other.handle;
+        consumer = other.consumer;
+        writing = other.writing;
+        file_size = other.file_size;
+        pos = other.pos;
+        buffer = other.buffer;
+        buffer_slot = other.buffer_slot;
+        buffer_start = other.buffer_start;
+        buffer_length = other.buffer_length;
+        window = other.window;
+        failed = other.failed;
+        other.storage = nullptr;
+        other.handle = -1;
+        other.buffer = nullptr;
+        other.buffer_slot = -1;
+    }
+    return *this;
+}
+
+StorageFile::operator bool() const {
+    return storage != nullptr;
+}
+
+// Loads a sector-aligned window covering `offset`. The window doubles while
+// reads move forward through the file (small skips included) and drops back
+// on any other jump.
+bool StorageFile::fill(uint32_t offset) {
+    uint32_t end = buffer_start + buffer_length;
+    bool sequential = buffer_length > 0 && offset >= end && offset < end + window;
+    window = sequential ? (window * 2 > Storage::BUFFER_SIZE ? Storage::BUFFER_SIZE : window * 2)
+                        : Storage::MIN_WINDOW;
+
+    uint32_t start = offset & ~(Storage::SECTOR_SIZE - 1);
+    uint32_t length = window;
+    if (start + length > file_size) {
+        length = file_size - start;
+    }
+    buffer_start = start;
+    buffer_length = storage->timed_read(consumer, handle, start, buffer, length);
+    return offset < buffer_start + buffer_length;
+}
+
+size_t StorageFile::read(void* dst, size_t length) {
+    if (!storage || writing) {
+        return 0;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+    while (done < length && pos < file_size) {
+        size_t wanted = length - done;
+        if (wanted > file_size - pos) {
+            wanted = file_size - pos;
+        }
+
+        if (buffer && pos >= buffer_start && pos < buffer_start + buffer_length) {
+            size_t n = buffer_start + buffer_length - pos;
+            n = n < wanted ? n : wanted;
+            memcpy(out + done, buffer + (pos - buffer_start), n);
+            pos += n;
+            done += n;
+            continue;
+        }
+
+        // Whole sectors straight into the caller's memory when it asks for
+        // more than a buffer's worth, or when there is no buffer at all.
+        bool aligned = (pos & (Storage::SECTOR_SIZE - 1)) == 0;
+        if (!buffer || (aligned && wanted >= Storage::BUFFER_SIZE)) {
+            size_t n = buffer ? wanted & ~(Storage::SECTOR_SIZE - 1) : wanted;
+            size_t got = storage->timed_read(consumer, handle, pos, out + done, n);
+            pos += got;
+            done += got;
+            if (got < n) {
+                break;
+            }
+            continue;
+        }
+
+        if (!fill(pos)) {
+            break;
+        }
+    }
+    return done;
+}
+
+int StorageFile::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+// Writes the buffer out and returns how many of its bytes reached the backend.
+size_t StorageFile::flush() {
+    size_t n = storage->timed_write(consumer, handle, buffer, buffer_length);
+    if (n < buffer_length) {
+        failed = true;
+    }
+    buffer_length = 0;
+    return n;
+}
+
+size_t StorageFile::write(const void* src, size_t length) {
+    if (!storage || !writing || failed) {
+        return 0;
+    }
+    if (!buffer) {
+        size_t n = storage->timed_write(consumer, handle, src, length);
+        if (n < length) {
+            failed = true;
+        }
+        pos += n;
+        return n;
+    }
+
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    size_t done = 0;
+    size_t earlier = buffer_length; // buffered by previous calls
+    while (done < length) {
+        size_t n = Storage::BUFFER_SIZE - buffer_length;
+        n = n < length - done ? n : length - done;
+        memcpy(buffer + buffer_length, in + done, n);
+        buffer_length += n;
+        done += n;
+        if (buffer_length < Storage::BUFFER_SIZE) {
+            continue;
+        }
+        size_t written = flush();
+        if (failed) {
+            // Only the part of this call's bytes that reached the backend counts.
+            size_t ours = Storage::BUFFER_SIZE - earlier;
+            done = done - ours + (written > earlier ? written - earlier : 0);
+            break;
+        }
+        earlier = 0;
+    }
+    pos += done;
+    return done;
+}
+
+bool StorageFile::seek(uint32_t offset) {
+    if (!storage || writing || offset > file_size) {
+        return false;
+    }
+    pos = offset;
+    return true;
+}
+
+uint32_t StorageFile::position() const {
+    return pos;
+}
+
+uint32_t StorageFile::size() const {
+    return writing ? pos : file_size;
+}
+
+void StorageFile::release() {
+    Storage::release_buffer(buffer_slot);
+    buffer = nullptr;
+    buffer_slot = -1;
+}
+
+bool StorageFile::close() {
+    if (!storage) {
+        return true;
+    }
+    if (writing && buffer_length > 0 && !failed) {
+        flush();
+    }
+    bool ok = !failed;
+    storage->backend_close(handle);
+    release();
+    storage = nullptr;
+    handle = -1;
+    return ok;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Who is doing the I/O, for the per-consumer stats.
+enum StorageConsumer {
+    STORAGE_CONFIG,
+    STORAGE_ARTWORK,
+    STORAGE_AUDIO,
+    STORAGE_SFX,
+    STORAGE_INDEX,
+    STORAGE_TRACE,
+    STORAGE_CONSUMERS,
+};
+
+struct StorageStats {
+    uint32_t bytes;
+    uint32_t calls;   // backend operations (open, exists, read, write)
+    uint32_t busy_us; // time spent in backend reads and writes
+};
+
+class Storage;
+
+// A file opened through Storage. Reads are served from a pooled, sector
+// aligned buffer that is refilled with a read-ahead window which doubles while
+// access stays sequential; large aligned reads bypass the buffer. Writes are
+// buffered and must be sequential.
+class StorageFile {
+private:
+    Storage* storage;
+    int handle;
+    StorageConsumer consumer;
+    bool writing;
+    uint32_t file_size;
+    uint32_t pos;
+
+    uint8_t* buffer; // from the pool, nullptr when unbuffered
+    int buffer_slot;
+    uint32_t buffer_start;
+    uint32_t buffer_length;
+    uint32_t window;
+    bool failed; // a write fell short; later writes are refused
+
+    bool fill(uint32_t offset);
+    size_t flush();
+    void release();
+
+    friend class Storage;
+
+public:
+    StorageFile();
+    ~StorageFile();
+    StorageFile(StorageFile&& other);
+    StorageFile& operator=(StorageFile&& other);
+    StorageFile(const StorageFile&) = delete;
+    StorageFile& operator=(const StorageFile&) = delete;
+
+    explicit operator bool() const;
+
+    size_t read(void* dst, size_t length);
+    int read(); // next byte, or -1 at the end
+    // Returns how many bytes were buffered or written; after a failed write
+    // it returns 0 until the file is closed.
+    size_t write(const void* src, size_t length);
+    bool seek(uint32_t offset);
+    uint32_t position() const;
+    uint32_t size() const;
+    // False if any write, the final flush included, failed.
+    bool close();
+};
+
+// Storage backend (SD card, a host directory, ...) plus the read buffer pool
+// and I/O accounting shared by all of them.
+class Storage {
+public:
+    static const uint32_t SECTOR_SIZE = 512;
+    static const uint32_t BUFFER_SIZE = 4096; // 8 sectors
+    static const uint32_t MIN_WINDOW = 1024;
+    static const int POOL_BUFFERS = 4;
+
+    virtual ~Storage() {}
+
+    StorageFile open(const char* path, StorageConsumer consumer, bool write = false);
+    bool exists(const char* path, StorageConsumer consumer);
+
+    static StorageStats stats(StorageConsumer consumer);
+    static const char* consumer_name(StorageConsumer consumer);
+    // For I/O done outside this layer (the decoder reads its files itself).
+    static void account(StorageConsumer consumer, uint32_t bytes, uint32_t calls, uint32_t busy_us);
+
+protected:
+    // Backends return a small non-negative handle, or -1 on failure.
+    virtual int backend_open(const char* path, bool write) = 0;
+    virtual void backend_close(int handle) = 0;
+    virtual bool backend_exists(const char* path) = 0;
+    virtual uint32_t backend_size(int handle) = 0;
+    virtual size_t backend_read(int handle, uint32_t offset, void* dst, size_t length) = 0;
+    virtual size_t backend_write(int handle, const void* src, size_t length) = 0;
+    virtual uint32_t clock_us() = 0;
+
+private:
+    static uint8_t pool[POOL_BUFFERS][BUFFER_SIZE];
+    static std::atomic<bool> pool_used[POOL_BUFFERS];
+    static std::atomic<uint32_t> stat_bytes[STORAGE_CONSUMERS];
+    static std::atomic<uint32_t> stat_calls[STORAGE_CONSUMERS];
+    static std::atomic<uint32_t> stat_busy_us[STORAGE_CONSUMERS];
+
+    static uint8_t* acquire_buffer(int* slot);
+    static void release_buffer(int slot);
+
+    size_t timed_read(StorageConsumer consumer, int handle, uint32_t offset, void* dst, size_t length);
+    size_t timed_write(StorageConsumer consumer, int handle, const void* src, size_t length);
+
+    friend class StorageFile;
+};
\ No newline at end of file
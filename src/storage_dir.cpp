@@ -0,0 +1,67 @@
+#ifndef ARDUINO
+
+#include "storage_dir.h"
+#include <chrono>
+#include <sys/stat.h>
+
+DirStorage::DirStorage(const std::string& root) : root(root) {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        files[i] = nullptr;
+    }
+}
+
+DirStorage::~DirStorage() {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (files[i]) {
+            fclose(files[i]);
+        }
+    }
+}
+
+std::string DirStorage::full_path(const char* path) const {
+    return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+int DirStorage::backend_open(const char* path, bool write) {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (files[i]) {
+            continue;
+        }
+        files[i] = fopen(full_path(path).c_str(), write ? "wb" : "rb");
+        return files[i] ? i : -1;
+    }
+    return -1;
+}
+
+void DirStorage::backend_close(int handle) {
+    fclose(files[handle]);
+    files[handle] = nullptr;
+}
+
+bool DirStorage::backend_exists(const char* path) {
+    struct stat st;
+    return stat(full_path(path).c_str(), &st) == 0;
+}
+
+uint32_t DirStorage::backend_size(int handle) {
+    struct stat st;
+    return fstat(fileno(files[handle]), &st) == 0 ? st.st_size : 0;
+}
+
+size_t DirStorage::backend_read(int handle, uint32_t offset, void* dst, size_t length) {
+    if (fseek(files[handle], offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    return fread(dst, 1, length, files[handle]);
+}
+
+size_t DirStorage::backend_write(int handle, const void* src, size_t length) {
+    return fwrite(src, 1, length, files[handle]);
+}
+
+uint32_t DirStorage::clock_us() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
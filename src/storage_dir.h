@@ -0,0 +1,30 @@
+#pragma once
+
+#include "storage.h"
+#include <stdio.h>
+#include <string>
+
+// Storage over a host directory, standing in for the SD card when the storage
+// users are built and exercised off the device.
+class DirStorage : public Storage {
+private:
+    static const int MAX_OPEN_FILES = 6;
+
+    std::string root;
+    FILE* files[MAX_OPEN_FILES];
+
+    std::string full_path(const char* path) const;
+
+protected:
+    int backend_open(const char* path, bool write) override;
+    void backend_close(int handle) override;
+    bool backend_exists(const char* path) override;
+    uint32_t backend_size(int handle) override;
+    size_t backend_read(int handle, uint32_t offset, void* dst, size_t length) override;
+    size_t backend_write(int handle, const void* src, size_t length) override;
+    uint32_t clock_us() override;
+
+public:
+    explicit DirStorage(const std::string& root);
+    ~DirStorage();
+};
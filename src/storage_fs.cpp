@@ -0,0 +1,67 @@
+#include "storage_fs.h"
+#include "alloc_guard.h"
+#include <Arduino.h>
+#include <SD.h>
+
+FsStorage sd_storage(SD);
+
+FsStorage::FsStorage(fs::FS& fs) : fs(fs) {
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        slot_used[i] = false;
+    }
+}
+
+fs::FS& FsStorage::filesystem() {
+    return fs;
+}
+
+// The VFS allocates a handle per open file, and exists() is an open too.
+int FsStorage::backend_open(const char* path, bool write) {
+    AllocExempt file_open;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        bool expected = false;
+        if (!slot_used[i].compare_exchange_strong(expected, true)) {
+            continue;
+        }
+        files[i] = fs.open(path, write ? FILE_WRITE : FILE_READ);
+        if (!files[i] || files[i].isDirectory()) {
+            files[i] = File();
+            slot_used[i] = false;
+            return -1;
+        }
+        return i;
+    }
+    return -1;
+}
+
+void FsStorage::backend_close(int handle) {
+    AllocExempt file_open;
+    files[handle].close();
+    files[handle] = File();
+    slot_used[handle] = false;
+}
+
+bool FsStorage::backend_exists(const char* path) {
+    AllocExempt file_open;
+    return fs.exists(path);
+}
+
+uint32_t FsStorage::backend_size(int handle) {
+    return files[handle].size();
+}
+
+size_t FsStorage::backend_read(int handle, uint32_t offset, void* dst, size_t length) {
+    File& file = files[handle];
+    if (file.position() != offset && !file.seek(offset)) {
+        return 0;
+    }
+    return file.read(static_cast<uint8_t*>(dst), length);
+}
+
+size_t FsStorage::backend_write(int handle, const void* src, size_t length) {
+    return files[handle].write(static_cast<const uint8_t*>(src), length);
+}
+
+uint32_t FsStorage::clock_us() {
+    return micros();
+}
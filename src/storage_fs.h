@@ -0,0 +1,32 @@
+#pragma once
+
+#include "storage.h"
+#include <FS.h>
+
+// Storage over an Arduino filesystem (SD, SPIFFS). Open files live in a fixed
+// set of slots; the handle is the slot index.
+class FsStorage : public Storage {
+private:
+    static const int MAX_OPEN_FILES = 6;
+
+    fs::FS& fs;
+    File files[MAX_OPEN_FILES];
+    std::atomic<bool> slot_used[MAX_OPEN_FILES];
+
+protected:
+    int backend_open(const char* path, bool write) override;
+    void backend_close(int handle) override;
+    bool backend_exists(const char* path) override;
+    uint32_t backend_size(int handle) override;
+    size_t backend_read(int handle, uint32_t offset, void* dst, size_t length) override;
+    size_t backend_write(int handle, const void* src, size_t length) override;
+    uint32_t clock_us() override;
+
+public:
+    explicit FsStorage(fs::FS& fs);
+
+    // The filesystem underneath, for libraries that open files themselves.
+    fs::FS& filesystem();
+};
+
+extern FsStorage sd_storage;
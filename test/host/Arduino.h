@@ -0,0 +1,204 @@
+#pragma once
+
+// Just enough of the Arduino-ESP32 core for the firmware to build and run on a
+// host. Time is simulated: it only moves through host::advance_us(), delay()
+// and vTaskDelay(), so a test decides how long a loop() takes.
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define F(text) (text)
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define HEX 16
+
+// YB-ESP32-S3-AMP variant pins.
+#define LED_BUILTIN 47
+#define SS 10
+#define MOSI 11
+#define SCK 12
+#define MISO 13
+#define SS2 39
+#define MOSI2 40
+#define SCK2 41
+#define MISO2 42
+#define I2S_BCLK 5
+#define I2S_LRCLK 6
+#define I2S_DOUT 7
+
+class String {
+private:
+    std::string text;
+
+public:
+    String() {}
+    String(const char* s) : text(s ? s : "") {}
+
+    String& operator=(const char* s) {
+        text.assign(s ? s : "");
+        return *this;
+    }
+    bool operator==(const char* s) const {
+        return text == s;
+    }
+    bool operator==(const String& other) const {
+        return text == other.text;
+    }
+
+    const char* c_str() const {
+        return text.c_str();
+    }
+    unsigned int length() const {
+        return text.length();
+    }
+    bool isEmpty() const {
+        return text.empty();
+    }
+    bool reserve(unsigned int size) {
+        text.reserve(size);
+        return true;
+    }
+    bool endsWith(const char* suffix) const {
+        size_t n = strlen(suffix);
+        return n <= text.size() && text.compare(text.size() - n, n, suffix) == 0;
+    }
+};
+
+namespace host {
+
+inline uint64_t now_us = 0;
+
+inline void advance_us(uint64_t us) {
+    now_us += us;
+}
+
+// Serial input queued by a test, and whether output is echoed to stdout.
+inline std::string serial_input;
+inline bool serial_echo = false;
+// Called with every piece of serial output, for tests that watch the log.
+inline void (*serial_hook)(const char* text) = nullptr;
+
+// Handlers registered with attachInterrupt(), by pin; tests fire them.
+inline void (*interrupts[49])() = {};
+
+inline void fire_interrupt(uint8_t pin) {
+    if (interrupts[pin]) {
+        interrupts[pin]();
+    }
+}
+
+} // namespace host
+
+inline unsigned long millis() {
+    return (unsigned long)(host::now_us / 1000);
+}
+
+inline unsigned long micros() {
+    return (unsigned long)host::now_us;
+}
+
+inline void delay(uint32_t ms) {
+    host::advance_us((uint64_t)ms * 1000);
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+inline uint8_t digitalPinToInterrupt(uint8_t pin) {
+    return pin;
+}
+
+inline void attachInterrupt(uint8_t pin, void (*handler)(), int) {
+    host::interrupts[pin] = handler;
+}
+
+class HostSerial {
+public:
+    void begin(unsigned long) {}
+    bool isPlugged() const {
+        return false;
+    }
+    explicit operator bool() const {
+        return true;
+    }
+
+    int available() {
+        return (int)host::serial_input.size();
+    }
+    int read() {
+        if (host::serial_input.empty()) {
+            return -1;
+        }
+        int c = (unsigned char)host::serial_input[0];
+        host::serial_input.erase(0, 1);
+        return c;
+    }
+
+    void print(const char* text) {
+        if (host::serial_hook) {
+            host::serial_hook(text);
+        }
+        if (host::serial_echo) {
+            fputs(text, stdout);
+        }
+    }
+    void println(const char* text) {
+        print(text);
+        print("\n");
+    }
+    void println(int value, int base) {
+        char text[16];
+        snprintf(text, sizeof(text), base == HEX ? "%X" : "%d", value);
+        println(text);
+    }
+};
+
+inline HostSerial Serial;
+
+class HostEsp {
+public:
+    uint32_t getCycleCount() {
+        return (uint32_t)(host::now_us * 240);
+    }
+    uint32_t getFreeHeap() {
+        return 256 * 1024;
+    }
+    uint32_t getFreePsram() {
+        return 4 * 1024 * 1024;
+    }
+};
+
+inline HostEsp ESP;
+
+inline bool psramFound() {
+    return true;
+}
+
+template <class T, class L, class H>
+inline T constrain(T value, L low, H high) {
+    return value < low ? low : (value > high ? high : value);
+}
+
+inline void* ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+// The ESP32 core pulls these in for every sketch.
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
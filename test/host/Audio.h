@@ -0,0 +1,174 @@
+#pragma once
+
+// Stand-in for the ESP32-audioI2S decoder. It treats any file as a 128 kbit/s
+// stream at 44.1 kHz: reading it into an input buffer, draining that at the
+// stream's byte rate as simulated time passes, and handing a synthetic stereo
+// frame per sample period to audio_process_i2s(), like the library's output
+// path does.
+//
+// Like the pinned library (2.0.0), it creates its input buffer on the first
+// connect and refuses setBufsize() from then on.
+
+#include <FS.h>
+
+namespace host {
+// Size of the decoder's input buffer once created, 0 before the first connect.
+inline uint32_t audio_buffer_size = 0;
+// Bytes the decoder gets from the card per loop; lower it to starve the stream.
+inline uint32_t audio_read_bytes = 1600;
+// The track last connected, and how many tracks have played to their end.
+inline const char* audio_file = "";
+inline uint32_t audio_eofs = 0;
+} // namespace host
+
+void audio_info(const char* info);
+void audio_eof_mp3(const char* info);
+void audio_process_i2s(uint32_t* sample, bool* continueI2S);
+
+class Audio {
+private:
+    static const uint32_t SAMPLE_RATE = 44100;
+    static const uint32_t BYTE_RATE = 16000;
+    static const uint32_t CHUNK = 1600;
+
+    fs::File file;
+    char name[64];
+    bool running;
+    bool paused;
+    bool allocated;
+    uint32_t file_size;
+    uint32_t file_pos;
+    uint32_t buffer_size;
+    uint32_t filled;
+    uint64_t last_us;
+    uint64_t frame_credit;
+    uint64_t byte_credit;
+    int32_t phase;
+    uint8_t chunk[CHUNK];
+
+    void refill() {
+        uint32_t n = min(min(buffer_size - filled, min((uint32_t)CHUNK, host::audio_read_bytes)), file_size - file_pos);
+        if (n > 0) {
+            n = file.read(chunk, n);
+            file_pos += n;
+            filled += n;
+        }
+    }
+
+public:
+    Audio()
+        : name(), running(false), paused(false), allocated(false), file_size(0), file_pos(0), buffer_size(6400), filled(0), last_us(0),
+          frame_credit(0), byte_credit(0), phase(0) {}
+
+    bool setPinout(uint8_t, uint8_t, uint8_t) {
+        return true;
+    }
+    void setVolume(uint8_t) {}
+
+    bool setBufsize(int ram, int psram) {
+        if (allocated) {
+            return false;
+        }
+        buffer_size = psram > 0 ? psram : ram;
+        return true;
+    }
+
+    bool connecttoFS(fs::FS& fs, const char* path) {
+        stopSong();
+        allocated = true;
+        host::audio_buffer_size = buffer_size;
+        file = fs.open(path);
+        if (!file || file.isDirectory()) {
+            file.close();
+            return false;
+        }
+        snprintf(name, sizeof(name), "%s", path);
+        host::audio_file = name;
+        running = true;
+        paused = false;
+        file_size = file.size();
+        file_pos = 0;
+        filled = 0;
+        last_us = host::now_us;
+        frame_credit = 0;
+        byte_credit = 0;
+        return true;
+    }
+
+    void loop() {
+        uint64_t elapsed = host::now_us - last_us;
+        last_us = host::now_us;
+        if (!running || paused) {
+            return;
+        }
+        refill();
+
+        frame_credit += elapsed * SAMPLE_RATE;
+        uint32_t frames = frame_credit / 1000000;
+        frame_credit %= 1000000;
+        for (uint32_t i = 0; i < frames && filled > 0; i++) {
+            byte_credit += BYTE_RATE;
+            uint32_t bytes = min((uint32_t)(byte_credit / SAMPLE_RATE), filled);
+            byte_credit %= SAMPLE_RATE;
+            filled -= bytes;
+
+            phase = (phase + 601) & 0xFFFF; // a ~400 Hz sawtooth at -12 dB
+            int16_t level = (int16_t)((phase - 0x8000) / 4);
+            uint32_t sample = (uint16_t)level | ((uint32_t)(uint16_t)level << 16);
+            bool keep = true;
+            audio_process_i2s(&sample, &keep);
+        }
+
+        if (file_pos == file_size && filled == 0) {
+            stopSong();
+            host::audio_eofs++;
+            audio_eof_mp3(name);
+        }
+    }
+
+    uint32_t stopSong() {
+        running = false;
+        paused = false;
+        filled = 0;
+        file.close();
+        return 0;
+    }
+
+    bool pauseResume() {
+        if (!running) {
+            return false;
+        }
+        paused = !paused;
+        return true;
+    }
+
+    uint32_t getFileSize() {
+        return running ? file_size : 0;
+    }
+    uint32_t getFilePos() {
+        return running ? file_pos : 0;
+    }
+    bool setFilePos(uint32_t pos) {
+        if (!running || pos > file_size || !file.seek(pos)) {
+            return false;
+        }
+        file_pos = pos;
+        filled = 0;
+        return true;
+    }
+    uint32_t getAudioCurrentTime() {
+        return running ? (file_pos - filled) / BYTE_RATE : 0;
+    }
+    bool setAudioPlayPosition(uint16_t seconds) {
+        return setFilePos(min((uint32_t)seconds * BYTE_RATE, file_size));
+    }
+    uint32_t getSampleRate() {
+        return running ? SAMPLE_RATE : 0;
+    }
+    uint32_t inBufferFilled() {
+        return filled;
+    }
+    uint32_t inBufferFree() {
+        return buffer_size - filled;
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+// Arduino FS over a host directory: paths are taken relative to the root a
+// test points the filesystem at.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+
+namespace host {
+// Space left on the card; writes past it come up short, as on a full card.
+inline uint64_t fs_free_bytes = UINT64_MAX;
+} // namespace host
+
+namespace fs {
+
+class File {
+private:
+    FILE* fp;
+    bool directory;
+    uint32_t length;
+
+public:
+    File() : fp(nullptr), directory(false), length(0) {}
+    File(FILE* f, bool dir, uint32_t size) : fp(f), directory(dir), length(size) {}
+    File(File&& other) : File() {
+        *this = static_cast<File&&>(other);
+    }
+    File& operator=(File&& other) {
+        if (this != &other) {
+            close();
+            fp = other.fp;
+            directory = other.directory;
+            length = other.length;
+            other.fp = nullptr;
+            other.directory = false;
+        }
+        return *this;
+    }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File() {
+        close();
+    }
+
+    explicit operator bool() const {
+        return fp != nullptr || directory;
+    }
+    bool isDirectory() const {
+        return directory;
+    }
+    size_t size() const {
+        return length;
+    }
+    size_t position() const {
+        return fp ? (size_t)ftell(fp) : 0;
+    }
+    bool seek(uint32_t offset) {
+        return fp && fseek(fp, offset, SEEK_SET) == 0;
+    }
+    size_t read(uint8_t* dst, size_t n) {
+        return fp ? fread(dst, 1, n, fp) : 0;
+    }
+    size_t write(const uint8_t* src, size_t n) {
+        if (!fp) {
+            return 0;
+        }
+        n = (size_t)min((uint64_t)n, host::fs_free_bytes);
+        size_t written = fwrite(src, 1, n, fp);
+        host::fs_free_bytes -= written;
+        length += written;
+        return written;
+    }
+    void close() {
+        if (fp) {
+            fclose(fp);
+        }
+        fp = nullptr;
+        directory = false;
+    }
+};
+
+class FS {
+private:
+    std::string root;
+
+    std::string full_path(const char* path) const {
+        return root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+public:
+    void set_root(const char* dir) {
+        root = dir;
+    }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        std::string full = full_path(path);
+        struct stat st;
+        bool found = stat(full.c_str(), &st) == 0;
+        if (found && S_ISDIR(st.st_mode)) {
+            return File(nullptr, true, 0);
+        }
+        if (!found && mode[0] == 'r') {
+            return File();
+        }
+        FILE* f = fopen(full.c_str(), mode[0] == 'w' ? "wb" : "rb");
+        if (f) {
+            setvbuf(f, nullptr, _IONBF, 0); // Storage buffers; a stdio buffer would be a lazy malloc
+        }
+        return f ? File(f, false, mode[0] == 'w' ? 0 : (uint32_t)st.st_size) : File();
+    }
+
+    bool exists(const char* path) {
+        struct stat st;
+        return stat(full_path(path).c_str(), &st) == 0;
+    }
+};
+
+} // namespace fs
+
+using fs::File;
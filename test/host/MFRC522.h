@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+
+// A card a test can put on or lift off the reader. Only NTAG/Ultralight data
+// is modelled: sak 0x00 and 4-byte pages from page 0.
+struct HostNfcCard {
+    bool present;
+    bool halted;
+    byte uid[10];
+    byte uid_size;
+    byte sak;
+    byte pages[64][4];
+};
+
+namespace host {
+inline HostNfcCard nfc_card = {};
+} // namespace host
+
+class MFRC522 {
+public:
+    static const byte MF_KEY_SIZE = 6;
+
+    enum PCD_Register : byte {
+        TxModeReg = 0x12 << 1,
+        RxModeReg = 0x13 << 1,
+        ModWidthReg = 0x24 << 1,
+    };
+
+    enum PICC_Command : byte {
+        PICC_CMD_MF_AUTH_KEY_A = 0x60,
+    };
+
+    enum StatusCode : byte {
+        STATUS_OK,
+        STATUS_ERROR,
+        STATUS_COLLISION,
+        STATUS_TIMEOUT,
+    };
+
+    enum PICC_Type : byte {
+        PICC_TYPE_UNKNOWN,
+        PICC_TYPE_MIFARE_MINI,
+        PICC_TYPE_MIFARE_1K,
+        PICC_TYPE_MIFARE_4K,
+        PICC_TYPE_MIFARE_UL,
+    };
+
+    struct Uid {
+        byte size;
+        byte uidByte[10];
+        byte sak;
+    };
+
+    struct MIFARE_Key {
+        byte keyByte[MF_KEY_SIZE];
+    };
+
+    Uid uid;
+
+    MFRC522(byte, byte) : uid() {}
+
+    void PCD_Init(byte, byte) {}
+    void PCD_WriteRegister(PCD_Register, byte) {}
+    void PCD_StopCrypto1() {}
+
+    bool PICC_IsNewCardPresent() {
+        return host::nfc_card.present && !host::nfc_card.halted;
+    }
+
+    bool PICC_ReadCardSerial() {
+        uid.size = host::nfc_card.uid_size;
+        memcpy(uid.uidByte, host::nfc_card.uid, sizeof(uid.uidByte));
+        uid.sak = host::nfc_card.sak;
+        return true;
+    }
+
+    StatusCode PICC_HaltA() {
+        host::nfc_card.halted = true;
+        return STATUS_OK;
+    }
+
+    StatusCode PICC_WakeupA(byte*, byte*) {
+        if (!host::nfc_card.present) {
+            return STATUS_TIMEOUT;
+        }
+        host::nfc_card.halted = false;
+        return STATUS_OK;
+    }
+
+    static PICC_Type PICC_GetType(byte sak) {
+        switch (sak & 0x7F) {
+            case 0x00:
+                return PICC_TYPE_MIFARE_UL;
+            case 0x09:
+                return PICC_TYPE_MIFARE_MINI;
+            case 0x08:
+                return PICC_TYPE_MIFARE_1K;
+            case 0x18:
+                return PICC_TYPE_MIFARE_4K;
+            default:
+                return PICC_TYPE_UNKNOWN;
+        }
+    }
+
+    StatusCode PCD_Authenticate(byte, byte, MIFARE_Key*, Uid*) {
+        return STATUS_ERROR;
+    }
+
+    // Four pages from blockAddr on, as an NTAG answers READ.
+    StatusCode MIFARE_Read(byte blockAddr, byte* buffer, byte* bufferSize) {
+        if (*bufferSize < 18 || blockAddr + 4 > 64) {
+            return STATUS_ERROR;
+        }
+        memcpy(buffer, host::nfc_card.pages[blockAddr], 16);
+        *bufferSize = 18;
+        return STATUS_OK;
+    }
+};
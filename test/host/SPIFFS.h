@@ -0,0 +1,13 @@
+#pragma once
+
+#include <FS.h>
+
+// Not mounted on the host: the config comes from the SD directory.
+class SPIFFSFS : public fs::FS {
+public:
+    bool begin() {
+        return false;
+    }
+};
+
+inline SPIFFSFS SPIFFS;
@@ -0,0 +1,188 @@
+#pragma once
+
+// The part of YAMLDuino's YAMLNode the config loader uses, over a parser for
+// the block-style subset config.yaml is written in: nested maps, "- " lists,
+// plain or quoted scalars and # comments.
+
+#include <memory>
+#include <string.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+class YAMLNode {
+private:
+    struct Data {
+        enum Kind { NUL, SCALAR, MAP, SEQUENCE } kind = NUL;
+        std::string value;
+        std::vector<std::pair<std::string, YAMLNode>> entries;
+        std::vector<YAMLNode> items;
+    };
+
+    struct Line {
+        size_t indent;
+        std::string text;
+    };
+
+    std::shared_ptr<Data> data;
+
+    static std::string strip_comment(const std::string& text) {
+        char quote = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (quote) {
+                quote = c == quote ? 0 : quote;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '#' && (i == 0 || text[i - 1] == ' ')) {
+                return text.substr(0, i);
+            }
+        }
+        return text;
+    }
+
+    static std::string trim(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            return "";
+        }
+        return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+    }
+
+    static YAMLNode scalar_node(const std::string& text) {
+        YAMLNode node;
+        node.data->kind = Data::SCALAR;
+        node.data->value = text;
+        if (text.size() >= 2 && (text[0] == '"' || text[0] == '\'') && text.back() == text[0]) {
+            node.data->value = text.substr(1, text.size() - 2);
+        }
+        return node;
+    }
+
+    static size_t find_colon(const std::string& text) {
+        char quote = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            if (quote) {
+                quote = c == quote ? 0 : quote;
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == ':' && (i + 1 == text.size() || text[i + 1] == ' ')) {
+                return i;
+            }
+        }
+        return std::string::npos;
+    }
+
+    static bool is_item(const Line& line) {
+        return line.text == "-" || line.text.compare(0, 2, "- ") == 0;
+    }
+
+    static YAMLNode parse_block(std::vector<Line>& lines, size_t& i, size_t indent) {
+        YAMLNode node;
+        if (i >= lines.size() || lines[i].indent < indent) {
+            return node;
+        }
+        indent = lines[i].indent;
+
+        if (is_item(lines[i])) {
+            node.data->kind = Data::SEQUENCE;
+            while (i < lines.size() && lines[i].indent == indent && is_item(lines[i])) {
+                std::string rest = trim(lines[i].text.substr(1));
+                if (rest.empty()) {
+                    i++;
+                    node.data->items.push_back(parse_block(lines, i, indent + 1));
+                } else if (find_colon(rest) != std::string::npos) {
+                    // "- key: value" opens a map indented past the dash.
+                    lines[i].indent = indent + 2;
+                    lines[i].text = rest;
+                    node.data->items.push_back(parse_block(lines, i, indent + 2));
+                } else {
+                    node.data->items.push_back(scalar_node(rest));
+                    i++;
+                }
+            }
+            return node;
+        }
+
+        node.data->kind = Data::MAP;
+        while (i < lines.size() && lines[i].indent == indent && !is_item(lines[i])) {
+            const std::string& text = lines[i].text;
+            size_t colon = find_colon(text);
+            if (colon == std::string::npos) {
+                throw std::runtime_error("expected 'key: value': " + text);
+            }
+            std::string key = trim(text.substr(0, colon));
+            std::string rest = trim(text.substr(colon + 1));
+            i++;
+            if (!rest.empty()) {
+                node.data->entries.emplace_back(key, scalar_node(rest));
+            } else if (i < lines.size() && (lines[i].indent > indent || (lines[i].indent == indent && is_item(lines[i])))) {
+                node.data->entries.emplace_back(key, parse_block(lines, i, lines[i].indent));
+            } else {
+                node.data->entries.emplace_back(key, YAMLNode());
+            }
+        }
+        return node;
+    }
+
+public:
+    YAMLNode() : data(std::make_shared<Data>()) {}
+
+    static YAMLNode loadString(const char* text) {
+        std::vector<Line> lines;
+        const char* p = text;
+        while (*p) {
+            const char* end = strchr(p, '\n');
+            std::string raw = end ? std::string(p, end - p) : std::string(p);
+            p = end ? end + 1 : p + raw.size();
+            std::string content = strip_comment(raw);
+            if (trim(content).empty()) {
+                continue;
+            }
+            size_t indent = content.find_first_not_of(' ');
+            lines.push_back({indent, trim(content)});
+        }
+        size_t i = 0;
+        YAMLNode root = parse_block(lines, i, 0);
+        if (i != lines.size()) {
+            throw std::runtime_error("unexpected indentation: " + lines[i].text);
+        }
+        return root;
+    }
+
+    bool isNull() const {
+        return data->kind == Data::NUL;
+    }
+    bool isScalar() const {
+        return data->kind == Data::SCALAR;
+    }
+    bool isMap() const {
+        return data->kind == Data::MAP;
+    }
+    bool isSequence() const {
+        return data->kind == Data::SEQUENCE;
+    }
+    const char* scalar() const {
+        return data->value.c_str();
+    }
+    size_t size() const {
+        return isSequence() ? data->items.size() : data->entries.size();
+    }
+
+    YAMLNode operator[](const char* key) const {
+        for (const auto& entry : data->entries) {
+            if (entry.first == key) {
+                return entry.second;
+            }
+        }
+        return YAMLNode();
+    }
+    YAMLNode operator[](size_t index) const {
+        return index < data->items.size() ? data->items[index] : YAMLNode();
+    }
+    YAMLNode operator[](int index) const {
+        return (*this)[(size_t)index];
+    }
+};
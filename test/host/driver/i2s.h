@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+typedef enum { I2S_NUM_0, I2S_NUM_1 } i2s_port_t;
+
+// The DAC takes whatever it is given.
+inline esp_err_t i2s_write(i2s_port_t, const void*, size_t size, size_t* written, uint32_t) {
+    *written = size;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_set_sample_rates(i2s_port_t, uint32_t) {
+    return ESP_OK;
+}
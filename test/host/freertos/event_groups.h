@@ -0,0 +1,33 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+typedef uint32_t EventBits_t;
+
+struct HostEventGroup {
+    EventBits_t bits;
+};
+typedef HostEventGroup* EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    return new HostEventGroup{0};
+}
+
+inline void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    group->bits |= bits;
+    return group->bits;
+}
+
+// Tasks have finished by the time anyone waits, so there is nothing to block on.
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t, BaseType_t clear, BaseType_t,
+                                       TickType_t) {
+    EventBits_t bits = group->bits;
+    if (clear) {
+        group->bits = 0;
+    }
+    return bits;
+}
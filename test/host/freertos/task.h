@@ -0,0 +1,40 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <Arduino.h>
+
+// Tasks run to completion as soon as they are created, on the calling thread,
+// with their own handle while they run. That keeps a host run deterministic
+// and lets per-task bookkeeping (AllocGuard) tell them apart.
+
+struct HostTask {};
+typedef HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+namespace host {
+inline HostTask main_task;
+inline TaskHandle_t current_task = &main_task;
+} // namespace host
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return host::current_task;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char*, uint32_t, void* param, UBaseType_t,
+                                          TaskHandle_t* created, BaseType_t) {
+    HostTask handle;
+    TaskHandle_t caller = host::current_task;
+    host::current_task = &handle;
+    task(param);
+    host::current_task = caller;
+    if (created) {
+        *created = nullptr; // already gone
+    }
+    return pdPASS;
+}
+
+inline void vTaskDelete(TaskHandle_t) {}
+
+inline void vTaskDelay(TickType_t ticks) {
+    delay(ticks * portTICK_PERIOD_MS);
+}
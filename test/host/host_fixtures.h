@@ -0,0 +1,165 @@
+#pragma once
+
+// SD card contents, cards and input wiring shared by the tests that boot the
+// whole firmware (setup() and loop()) on the host.
+
+#include "board.h"
+#include <Arduino.h>
+#include <MFRC522.h>
+#include <SD.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <unity.h>
+
+static const uint8_t CARD_TRACK_A[] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6};
+static const uint8_t CARD_TRACK_B[] = {0x9B, 0xD1, 0xC7, 0x05};
+static const uint8_t CARD_NDEF[] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+static const uint8_t CARD_STRANGER[] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+inline std::string root; // the SD card's directory while the fixtures exist
+
+inline void write_file(const char* path, const void* data, size_t length) {
+    std::string full = root + path;
+    FILE* f = fopen(full.c_str(), "wb");
+    TEST_ASSERT_TRUE(f != nullptr);
+    fwrite(data, 1, length, f);
+    fclose(f);
+}
+
+inline void put_le(std::string& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+// MPEG-1 layer III, 128 kbit/s, 44.1 kHz frames; only the headers matter.
+inline void write_mp3(const char* path, uint32_t seconds) {
+    std::string data;
+    uint32_t frames = seconds * 44100 / 1152;
+    for (uint32_t i = 0; i < frames; i++) {
+        std::string frame(417, '\0');
+        frame[0] = (char)0xFF;
+        frame[1] = (char)0xFB;
+        frame[2] = (char)0x90;
+        data += frame;
+    }
+    write_file(path, data.data(), data.size());
+}
+
+inline void write_wav(const char* path, uint32_t frames) {
+    std::string data = "RIFF";
+    put_le(data, 36 + frames * 2, 4);
+    data += "WAVEfmt ";
+    put_le(data, 16, 4);
+    put_le(data, 1, 2);     // PCM
+    put_le(data, 1, 2);     // mono
+    put_le(data, 22050, 4);
+    put_le(data, 44100, 4); // byte rate
+    put_le(data, 2, 2);     // block align
+    put_le(data, 16, 2);
+    data += "data";
+    put_le(data, frames * 2, 4);
+    for (uint32_t i = 0; i < frames; i++) {
+        put_le(data, (i % 50) * 400, 2);
+    }
+    write_file(path, data.data(), data.size());
+}
+
+inline void write_bmp(const char* path) {
+    const uint32_t size = 48;
+    const uint32_t row = (size + 31) / 32 * 4;
+    std::string data = "BM";
+    put_le(data, 62 + row * size, 4);
+    put_le(data, 0, 4);
+    put_le(data, 62, 4); // pixel data offset
+    put_le(data, 40, 4);
+    put_le(data, size, 4);
+    put_le(data, size, 4);
+    put_le(data, 1, 2);
+    put_le(data, 1, 2); // bits per pixel
+    data.append(24, '\0');
+    put_le(data, 0x00000000, 4); // palette
+    put_le(data, 0x00FFFFFF, 4);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < row; x++) {
+            data += (char)((x + y) % 2 ? 0xAA : 0x55);
+        }
+    }
+    write_file(path, data.data(), data.size());
+}
+
+inline void write_fixtures() {
+    char dir[] = "/tmp/talepod-sd-XXXXXX";
+    TEST_ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    root = dir;
+    mkdir((root + "/audiodb").c_str(), 0755);
+
+    const char* config =
+        "default_volume: 12\n"
+        "audiodb_path: \"/audiodb\"\n"
+        "unknown_card_sfx: \"sad_trombone.wav\"\n"
+        "click_sfx: \"click.wav\"\n"
+        "cards:\n"
+        "  - id: \"04:A1:B2:C3:D4:E5:F6\"\n"
+        "    file: \"a.mp3\"\n"
+        "    name: \"Track A\"\n"
+        "  - id: \"9B:D1:C7:05\"\n"
+        "    file: \"b.mp3\"\n"
+        "    name: \"Track B\"\n";
+    write_file("/config.yaml", config, strlen(config));
+    write_mp3("/audiodb/a.mp3", 90);
+    write_mp3("/audiodb/b.mp3", 150);
+    write_mp3("/audiodb/c.mp3", 8); // ends on its own
+    write_bmp("/audiodb/b.mp3.bmp");
+    write_wav("/audiodb/click.wav", 1100);
+    write_wav("/audiodb/sad_trombone.wav", 33000);
+
+    SD.set_root(root.c_str());
+}
+
+inline void remove_fixtures() {
+    std::string command = "rm -rf " + root;
+    TEST_ASSERT_EQUAL(0, system(command.c_str()));
+}
+
+inline void put_card(const uint8_t* uid, uint8_t size, const char* ndef_path = nullptr) {
+    HostNfcCard& card = host::nfc_card;
+    memset(&card, 0, sizeof(card));
+    memcpy(card.uid, uid, size);
+    card.uid_size = size;
+    card.sak = 0x00; // NTAG
+    if (ndef_path) {
+        // Page 4 on: an NDEF message TLV holding one short URI record.
+        uint8_t path_length = strlen(ndef_path);
+        uint8_t* data = card.pages[4];
+        data[0] = 0x03;
+        data[1] = 5 + path_length;
+        data[2] = 0xD1; // MB, ME, SR, well-known type
+        data[3] = 1;
+        data[4] = 1 + path_length;
+        data[5] = 'U';
+        data[6] = 0x00; // no URI prefix
+        memcpy(data + 7, ndef_path, path_length);
+        data[7 + path_length] = 0xFE;
+    }
+    card.present = true;
+}
+
+inline void lift_card() {
+    host::nfc_card.present = false;
+}
+
+// A detent is a falling CLK edge read against DT, followed by a contact
+// bounce the decoder has to reject.
+inline void encoder_edge(bool cw) {
+    FakeGpio::set<Board::EncoderDt>(cw);
+    FakeGpio::set<Board::EncoderClk>(false);
+    FakeGpio::cycle_count = ESP.getCycleCount();
+    host::fire_interrupt(Board::EncoderClk::number);
+    FakeGpio::set<Board::EncoderClk>(true);
+}
+
+inline void set_button(bool pressed) {
+    FakeGpio::set<Board::EncoderSw>(!pressed);
+}
@@ -0,0 +1,140 @@
+// Runs the firmware's setup() and loop() through a simulated hour of card taps,
+// encoder spins, button presses, serial keys and playback, and fails on any
+// heap allocation the main loop makes once booted. It also checks the script
+// really ran: both tracks played, the card's own track ended, the unknown card
+// got its effect and the idle indexer wrote sidecars.
+
+#include "alloc_guard.h"
+#include "app.h"
+#include "host_fixtures.h"
+#include <Audio.h>
+#include <unity.h>
+
+void setup();
+void loop();
+
+extern App app;
+
+static const uint32_t SOAK_MS = 3600UL * 1000;
+static const uint32_t CYCLE_MS = 60UL * 1000; // the input script repeats every minute
+static const uint32_t DETENT_MS = 60;
+
+// Inputs for one millisecond of the minute-long script.
+static void drive_inputs(uint32_t t) {
+    // Card A, then encoder volume spins with bounce on every edge.
+    if (t == 0) put_card(CARD_TRACK_A, sizeof(CARD_TRACK_A));
+    if (t == 1500) lift_card();
+    if (t >= 5000 && t < 5000 + 10 * DETENT_MS && (t - 5000) % DETENT_MS <= 1) encoder_edge(true);
+    if (t >= 6000 && t < 6000 + 10 * DETENT_MS && (t - 6000) % DETENT_MS <= 1) encoder_edge(false);
+
+    // Press and hold with bounce, scrub three detents, release with bounce.
+    if (t == 10000 || t == 10002) set_button(true);
+    if (t == 10001) set_button(false);
+    if (t >= 10300 && t < 10300 + 3 * DETENT_MS && (t - 10300) % DETENT_MS == 0) encoder_edge(true);
+    if (t == 11000 || t == 11002) set_button(false);
+    if (t == 11001) set_button(true);
+
+    // Short presses: pause, then resume.
+    if (t == 15000 || t == 17000) set_button(true);
+    if (t == 15150 || t == 17150) set_button(false);
+
+    if (t == 20000) host::serial_input += ">";
+    if (t == 21000) host::serial_input += "<";
+    if (t == 22000) host::serial_input += "i";
+
+    // Card B with artwork, stopped and resumed from where it was.
+    if (t == 25000) put_card(CARD_TRACK_B, sizeof(CARD_TRACK_B));
+    if (t == 26500) lift_card();
+    if (t == 30000) host::serial_input += "s";
+    if (t == 32000) host::serial_input += "p";
+
+    // An unknown card plays its effect over the music.
+    if (t == 35000) put_card(CARD_STRANGER, sizeof(CARD_STRANGER));
+    if (t == 36000) lift_card();
+
+    // A card carrying its own track, which runs to the end; effects and the
+    // seek indexer then run while idle.
+    if (t == 40000) put_card(CARD_NDEF, sizeof(CARD_NDEF), "c.mp3");
+    if (t == 41000) lift_card();
+    if (t == 52000) host::serial_input += "+";
+    if (t == 53000) host::serial_input += "-";
+}
+
+// Per run of the script; nothing here may allocate.
+static uint32_t played_a;
+static uint32_t played_b;
+static uint32_t played_c_to_end;
+static uint32_t unknown_card_effects;
+
+static bool playing(const char* track) {
+    size_t file_length = strlen(host::audio_file);
+    size_t track_length = strlen(track);
+    return app.get_state() == APP_STATE_PLAYING && file_length >= track_length &&
+           strcmp(host::audio_file + file_length - track_length, track) == 0;
+}
+
+static void watch_log(const char* text) {
+    if (strcmp(text, "Unknown card effect playing") == 0) {
+        unknown_card_effects++;
+    }
+}
+
+// Checks for one millisecond of the script, just before the inputs that
+// move it on.
+static void check_progress(uint32_t t) {
+    if (t == 1400 && playing("/a.mp3")) played_a++;
+    if (t == 29000 && playing("/b.mp3")) played_b++;
+    if (t == 39000 && playing("/b.mp3")) played_b++; // resumed, with the effect over it
+    if (t == 59000 && app.get_state() == APP_STATE_IDLE && strstr(host::audio_file, "/c.mp3")) played_c_to_end++;
+}
+
+static bool sidecar_written(const char* track) {
+    std::string path = root + "/audiodb/" + track + ".idx";
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && st.st_size > 0;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_steady_state_makes_no_heap_allocations() {
+    write_fixtures();
+    setup();
+
+    host::serial_hook = watch_log;
+    uint32_t eofs_at_start = host::audio_eofs;
+    uint32_t allocations_at_start = AllocGuard::count();
+    uint32_t exempt_at_start = AllocGuard::exempt_count();
+    for (uint32_t ms = 0; ms < SOAK_MS; ms++) {
+        check_progress(ms % CYCLE_MS);
+        drive_inputs(ms % CYCLE_MS);
+        loop(); // takes 1 ms of simulated time
+    }
+    uint32_t allocations = AllocGuard::count() - allocations_at_start;
+    uint32_t exempt = AllocGuard::exempt_count() - exempt_at_start;
+    host::serial_hook = nullptr;
+
+    const uint32_t cycles = SOAK_MS / CYCLE_MS;
+    TEST_ASSERT_EQUAL_UINT32(cycles, played_a);
+    TEST_ASSERT_EQUAL_UINT32(2 * cycles, played_b);
+    TEST_ASSERT_EQUAL_UINT32(cycles, played_c_to_end);
+    TEST_ASSERT_EQUAL_UINT32(cycles, host::audio_eofs - eofs_at_start); // c.mp3 is the only one to end
+    TEST_ASSERT_EQUAL_UINT32(cycles, unknown_card_effects);
+    TEST_ASSERT_TRUE(sidecar_written("a.mp3"));
+    TEST_ASSERT_TRUE(sidecar_written("b.mp3"));
+    TEST_ASSERT_TRUE(sidecar_written("c.mp3"));
+    remove_fixtures();
+
+    char summary[96];
+    snprintf(summary, sizeof(summary), "%u heap allocations in the main loop (+%u exempt)", allocations, exempt);
+    TEST_MESSAGE(summary);
+    TEST_ASSERT_GREATER_THAN(0, exempt); // the script did open tracks
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, allocations, summary);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_steady_state_makes_no_heap_allocations);
+    return UNITY_END();
+}
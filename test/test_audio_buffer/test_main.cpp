@@ -0,0 +1,96 @@
+// The adaptive input buffer against a decoder that, like the pinned library,
+// only takes a new size before its first track: the size saved by an earlier
+// boot is applied at startup, and one picked while starving is saved for the
+// next boot instead of being forced on the running decoder.
+
+#include "app.h"
+#include "audio_monitor.h"
+#include "host_fixtures.h"
+#include <Audio.h>
+#include <unity.h>
+
+void setup();
+void loop();
+
+extern App app;
+
+static const uint32_t SAVED_SIZE = 12 * 1024;
+
+static void run_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        loop(); // takes 1 ms of simulated time
+    }
+}
+
+static void press_key(char key) {
+    host::serial_input += key;
+    loop();
+}
+
+static void write_buffer_state(uint32_t magic, uint32_t size) {
+    uint32_t state[2] = {magic, size};
+    write_file(AudioMonitor::STATE_PATH, state, sizeof(state));
+}
+
+// The size saved for the next boot, 0 if none.
+static uint32_t saved_buffer_size() {
+    std::string full = root + AudioMonitor::STATE_PATH;
+    FILE* f = fopen(full.c_str(), "rb");
+    if (!f) {
+        return 0;
+    }
+    uint32_t state[2] = {};
+    size_t n = fread(state, 1, sizeof(state), f);
+    fclose(f);
+    return n == sizeof(state) && state[0] == AudioMonitor::STATE_MAGIC ? state[1] : 0;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_saved_size_applies_at_boot_and_a_new_one_waits_for_the_next() {
+    write_fixtures();
+    write_buffer_state(AudioMonitor::STATE_MAGIC, SAVED_SIZE);
+    setup();
+    run_ms(100);
+    TEST_ASSERT_EQUAL_UINT32(0, host::audio_buffer_size);
+
+    put_card(CARD_TRACK_A, sizeof(CARD_TRACK_A));
+    run_ms(1000);
+    lift_card();
+    TEST_ASSERT_EQUAL_INT(APP_STATE_PLAYING, app.get_state());
+    TEST_ASSERT_EQUAL_UINT32(SAVED_SIZE, host::audio_buffer_size);
+
+    // 12 of the 16 bytes a millisecond the stream needs: the fill keeps
+    // dipping, so the monitor asks for more.
+    host::audio_read_bytes = 12;
+    run_ms(10000);
+
+    // A tap while paused still ends the old track, which saves its verdict.
+    press_key('p');
+    TEST_ASSERT_EQUAL_INT(APP_STATE_PAUSED, app.get_state());
+    put_card(CARD_TRACK_B, sizeof(CARD_TRACK_B));
+    run_ms(1000);
+    lift_card();
+    TEST_ASSERT_EQUAL_INT(APP_STATE_PLAYING, app.get_state());
+    TEST_ASSERT_EQUAL_UINT32(SAVED_SIZE * 3 / 2, saved_buffer_size());
+    TEST_ASSERT_EQUAL_UINT32(SAVED_SIZE, host::audio_buffer_size);
+
+    // Still starving on the old buffer: the bigger one is already waiting, so
+    // the recommendation doesn't compound within a boot.
+    run_ms(10000);
+    press_key('s');
+    host::audio_read_bytes = 1600;
+    TEST_ASSERT_EQUAL_INT(APP_STATE_IDLE, app.get_state());
+    TEST_ASSERT_EQUAL_UINT32(SAVED_SIZE * 3 / 2, saved_buffer_size());
+
+    run_ms(5000); // lets the idle seek indexing finish before the card goes
+    remove_fixtures();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_saved_size_applies_at_boot_and_a_new_one_waits_for_the_next);
+    return UNITY_END();
+}
@@ -0,0 +1,273 @@
+// The DSP kernels and stages as the host builds them: the scalar reference
+// paths, checked against hand-computed values and their own invariants.
+
+#include "dsp.h"
+#include <string.h>
+#include <unity.h>
+
+static const int32_t LIMIT = 29204; // LimiterStage::THRESHOLD, -1 dBFS
+
+static void fill_noise(int16_t* block, size_t count, uint32_t& seed) {
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        block[i] = (int16_t)(seed >> 16);
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_scalar_gain_floors_toward_negative_infinity() {
+    int16_t samples[] = {1, -1, 3, -3, 32767, -32768, 0, 100};
+    dsp_apply_gain_scalar(samples, 8, 16384); // 0.5
+    const int16_t expected[] = {0, -1, 1, -2, 16383, -16384, 0, 50};
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected, samples, 8);
+}
+
+void test_scalar_gain_extremes() {
+    int16_t samples[] = {32767, -32768, 12345, -1};
+    dsp_apply_gain_scalar(samples, 4, 32767);
+    const int16_t almost[] = {32766, -32767, 12344, -1};
+    TEST_ASSERT_EQUAL_INT16_ARRAY(almost, samples, 4);
+
+    dsp_apply_gain_scalar(samples, 4, 0);
+    const int16_t silent[] = {0, 0, 0, 0};
+    TEST_ASSERT_EQUAL_INT16_ARRAY(silent, samples, 4);
+}
+
+void test_gain_at_unity_leaves_samples_alone() {
+    int16_t samples[] = {32767, -32768, 1, -1};
+    const int16_t original[] = {32767, -32768, 1, -1};
+    dsp_apply_gain(samples, 4, DSP_UNITY);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(original, samples, 4);
+}
+
+void test_gain_kernel_matches_scalar_reference() {
+    uint32_t samples = 0;
+    TEST_ASSERT_EQUAL_UINT32(0, dsp_compare_gain_kernels(&samples));
+    TEST_ASSERT_GREATER_THAN(0, samples);
+}
+
+void test_volume_ramps_to_target_without_steps() {
+    VolumeStage volume;
+    volume.set_gain(DSP_UNITY / 4);
+
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    int16_t previous = 16384;
+    for (int b = 0; b < 32; b++) { // 1024 frames, twice the ramp
+        for (auto& s : block) {
+            s = 16384;
+        }
+        volume.process(block, DSP_BLOCK_FRAMES);
+        for (size_t i = 0; i < DSP_BLOCK_FRAMES * 2; i++) {
+            TEST_ASSERT_LESS_OR_EQUAL(previous, block[i]);
+            TEST_ASSERT_LESS_OR_EQUAL(32, previous - block[i]); // ~12k over 512 frames
+            previous = block[i];
+        }
+    }
+    TEST_ASSERT_EQUAL_INT16(4096, previous);
+}
+
+void test_volume_reset_jumps_to_target() {
+    VolumeStage volume;
+    volume.set_gain(DSP_UNITY / 2);
+    volume.reset();
+    int16_t frame[2] = {1000, -1000};
+    volume.process(frame, 1);
+    TEST_ASSERT_EQUAL_INT16(500, frame[0]);
+    TEST_ASSERT_EQUAL_INT16(-500, frame[1]);
+}
+
+// Level 21 is unity and the rest follow the decoder's own 64ths.
+void test_volume_levels_follow_the_decoder_curve() {
+    VolumeStage volume;
+    const uint8_t levels[] = {0, 1, 5, 10, 20, 21, 30};
+    const int16_t expected[] = {0, 256, 1536, 4352, 14848, 16384, 16384};
+    for (size_t i = 0; i < sizeof(levels); i++) {
+        volume.set_level(levels[i]);
+        volume.reset();
+        int16_t frame[2] = {16384, 16384};
+        volume.process(frame, 1);
+        TEST_ASSERT_EQUAL_INT16(expected[i], frame[0]);
+    }
+}
+
+void test_limiter_holds_full_scale_noise_under_threshold() {
+    LimiterStage limiter;
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    uint32_t seed = 7;
+    for (int b = 0; b < 256; b++) {
+        fill_noise(block, DSP_BLOCK_FRAMES * 2, seed);
+        limiter.process(block, DSP_BLOCK_FRAMES);
+        for (int16_t s : block) {
+            TEST_ASSERT_LESS_OR_EQUAL(LIMIT, s < 0 ? -(int32_t)s : s);
+        }
+    }
+}
+
+void test_limiter_passes_quiet_audio_one_block_late() {
+    LimiterStage limiter;
+    int16_t first[DSP_BLOCK_FRAMES * 2];
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    uint32_t seed = 3;
+    fill_noise(first, DSP_BLOCK_FRAMES * 2, seed);
+    dsp_apply_gain_scalar(first, DSP_BLOCK_FRAMES * 2, 8192); // well under -1 dBFS
+    memcpy(block, first, sizeof(block));
+
+    limiter.process(block, DSP_BLOCK_FRAMES);
+    for (int16_t s : block) {
+        TEST_ASSERT_EQUAL_INT16(0, s);
+    }
+    memset(block, 0, sizeof(block));
+    limiter.process(block, DSP_BLOCK_FRAMES);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(first, block, DSP_BLOCK_FRAMES * 2);
+}
+
+void test_eq_at_zero_db_is_a_bypass() {
+    EqStage eq;
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    int16_t original[DSP_BLOCK_FRAMES * 2];
+    uint32_t seed = 11;
+    fill_noise(original, DSP_BLOCK_FRAMES * 2, seed);
+    memcpy(block, original, sizeof(block));
+    eq.process(block, DSP_BLOCK_FRAMES);
+    TEST_ASSERT_EQUAL_INT16_ARRAY(original, block, DSP_BLOCK_FRAMES * 2);
+}
+
+// The treble shelf and the mid peak leave DC alone; the bass shelf lifts it by
+// its gain. A steady input must settle there, not drift or oscillate.
+void test_eq_settles_to_the_shelf_gain_at_dc() {
+    EqStage eq;
+    eq.set_gain(EQ_BASS, 6.0f);
+    eq.set_gain(EQ_MID, -3.0f);
+    eq.set_gain(EQ_TREBLE, -2.0f);
+
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    for (int b = 0; b < 200; b++) { // ~145 ms at 44.1 kHz
+        for (auto& s : block) {
+            s = 4000;
+        }
+        eq.process(block, DSP_BLOCK_FRAMES);
+    }
+    for (int16_t s : block) {
+        TEST_ASSERT_INT_WITHIN(4, 7981, s); // 4000 * 10^(6/20)
+    }
+}
+
+void test_eq_is_deterministic_after_reset() {
+    EqStage eq;
+    eq.set_gain(EQ_BASS, 3.0f);
+    eq.set_gain(EQ_TREBLE, -4.0f);
+
+    int16_t first[DSP_BLOCK_FRAMES * 2];
+    int16_t second[DSP_BLOCK_FRAMES * 2];
+    for (int run = 0; run < 2; run++) {
+        int16_t* out = run == 0 ? first : second;
+        uint32_t seed = 5;
+        eq.reset();
+        for (int b = 0; b < 16; b++) {
+            fill_noise(out, DSP_BLOCK_FRAMES * 2, seed);
+            eq.process(out, DSP_BLOCK_FRAMES);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT16_ARRAY(first, second, DSP_BLOCK_FRAMES * 2);
+}
+
+void test_chain_frames_come_out_one_block_late() {
+    VolumeStage volume;
+    volume.set_gain(DSP_UNITY / 2);
+    volume.reset();
+    DspChain chain;
+    chain.add(&volume);
+
+    int16_t in[DSP_BLOCK_FRAMES * 2 * 3];
+    uint32_t seed = 9;
+    fill_noise(in, sizeof(in) / sizeof(in[0]), seed);
+    int16_t expected[DSP_BLOCK_FRAMES * 2 * 3];
+    memcpy(expected, in, sizeof(in));
+    dsp_apply_gain_scalar(expected, sizeof(expected) / sizeof(expected[0]), DSP_UNITY / 2);
+
+    for (size_t i = 0; i < DSP_BLOCK_FRAMES * 3; i++) {
+        int16_t frame[2] = {in[2 * i], in[2 * i + 1]};
+        chain.process_frame(frame);
+        if (i < DSP_BLOCK_FRAMES) {
+            TEST_ASSERT_EQUAL_INT16(0, frame[0]);
+            TEST_ASSERT_EQUAL_INT16(0, frame[1]);
+        } else {
+            TEST_ASSERT_EQUAL_INT16(expected[2 * (i - DSP_BLOCK_FRAMES)], frame[0]);
+            TEST_ASSERT_EQUAL_INT16(expected[2 * (i - DSP_BLOCK_FRAMES) + 1], frame[1]);
+        }
+    }
+}
+
+// A reset between tracks drops both the adapter's pending block and the
+// limiter's look-ahead: after it, silence in is silence out.
+void test_chain_reset_leaves_nothing_of_the_old_audio() {
+    LimiterStage limiter;
+    DspChain chain;
+    chain.add(&limiter);
+
+    uint32_t seed = 11;
+    for (size_t i = 0; i < DSP_BLOCK_FRAMES * 3 + 5; i++) {
+        int16_t frame[2];
+        fill_noise(frame, 2, seed);
+        chain.process_frame(frame);
+    }
+    chain.reset();
+    for (size_t i = 0; i < DSP_BLOCK_FRAMES * 3; i++) {
+        int16_t frame[2] = {0, 0};
+        chain.process_frame(frame);
+        TEST_ASSERT_EQUAL_INT16(0, frame[0]);
+        TEST_ASSERT_EQUAL_INT16(0, frame[1]);
+    }
+
+    int16_t block[DSP_BLOCK_FRAMES * 2];
+    fill_noise(block, DSP_BLOCK_FRAMES * 2, seed);
+    chain.process(block, DSP_BLOCK_FRAMES);
+    chain.reset();
+    memset(block, 0, sizeof(block));
+    chain.process(block, DSP_BLOCK_FRAMES);
+    for (int16_t s : block) {
+        TEST_ASSERT_EQUAL_INT16(0, s);
+    }
+}
+
+static uint32_t fake_cycles;
+
+static uint32_t count_cycles() {
+    return fake_cycles += 100;
+}
+
+void test_benchmark_reports_every_stage_and_kernel() {
+    DspBenchmark results[8];
+    size_t count = dsp_benchmark(count_cycles, results, 8);
+    TEST_ASSERT_EQUAL_UINT32(5, count);
+    TEST_ASSERT_EQUAL_STRING("eq", results[0].name);
+    TEST_ASSERT_EQUAL_STRING("volume", results[1].name);
+    TEST_ASSERT_EQUAL_STRING("limiter", results[2].name);
+    TEST_ASSERT_EQUAL_STRING("gain (scalar)", results[3].name);
+    TEST_ASSERT_EQUAL_STRING("gain", results[4].name);
+
+    TEST_ASSERT_EQUAL_UINT32(2, dsp_benchmark(count_cycles, results, 2));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_scalar_gain_floors_toward_negative_infinity);
+    RUN_TEST(test_scalar_gain_extremes);
+    RUN_TEST(test_gain_at_unity_leaves_samples_alone);
+    RUN_TEST(test_gain_kernel_matches_scalar_reference);
+    RUN_TEST(test_volume_ramps_to_target_without_steps);
+    RUN_TEST(test_volume_reset_jumps_to_target);
+    RUN_TEST(test_volume_levels_follow_the_decoder_curve);
+    RUN_TEST(test_limiter_holds_full_scale_noise_under_threshold);
+    RUN_TEST(test_limiter_passes_quiet_audio_one_block_late);
+    RUN_TEST(test_eq_at_zero_db_is_a_bypass);
+    RUN_TEST(test_eq_settles_to_the_shelf_gain_at_dc);
+    RUN_TEST(test_eq_is_deterministic_after_reset);
+    RUN_TEST(test_chain_frames_come_out_one_block_late);
+    RUN_TEST(test_chain_reset_leaves_nothing_of_the_old_audio);
+    RUN_TEST(test_benchmark_reports_every_stage_and_kernel);
+    return UNITY_END();
+}
@@ -0,0 +1,142 @@
+// Records a scripted session through the firmware's real input paths, then
+// replays the trace twice as fast as possible: each replay must dispatch the
+// same events and end with the same state signature as the recording.
+
+#include "event_trace.h"
+#include "host_fixtures.h"
+#include <unity.h>
+
+void setup();
+void loop();
+
+extern EventTrace event_trace;
+
+static const uint32_t DETENT_MS = 60;
+static const uint32_t SESSION_MS = 60UL * 1000;
+
+static void run_ms(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        loop(); // takes 1 ms of simulated time
+    }
+}
+
+static void press_key(char key) {
+    host::serial_input += key;
+    loop();
+}
+
+// Every kind of event: taps and removals, encoder turns, a press, a
+// press-and-scrub, serial keys, and a track that ends on its own.
+static void drive_session(uint32_t t) {
+    if (t == 0) put_card(CARD_TRACK_A, sizeof(CARD_TRACK_A));
+    if (t == 1500) lift_card();
+    if (t >= 3000 && t < 3000 + 4 * DETENT_MS && (t - 3000) % DETENT_MS == 0) encoder_edge(true);
+    if (t >= 4000 && t < 4000 + 2 * DETENT_MS && (t - 4000) % DETENT_MS == 0) encoder_edge(false);
+
+    if (t == 6000) set_button(true);
+    if (t == 6150) set_button(false);
+    if (t == 8000) set_button(true);
+    if (t == 8150) set_button(false);
+
+    if (t == 10000) set_button(true);
+    if (t >= 10300 && t < 10300 + 3 * DETENT_MS && (t - 10300) % DETENT_MS == 0) encoder_edge(true);
+    if (t == 11000) set_button(false);
+
+    if (t == 13000) host::serial_input += ">";
+    if (t == 14000) host::serial_input += "<";
+    if (t == 15000) put_card(CARD_TRACK_B, sizeof(CARD_TRACK_B));
+    if (t == 16000) lift_card();
+    if (t == 18000) host::serial_input += "s";
+    if (t == 19000) host::serial_input += "p";
+    if (t == 21000) put_card(CARD_STRANGER, sizeof(CARD_STRANGER));
+    if (t == 22000) lift_card();
+    if (t == 25000) put_card(CARD_NDEF, sizeof(CARD_NDEF), "c.mp3");
+    if (t == 26000) lift_card();
+    if (t == 50000) host::serial_input += "+";
+}
+
+// Leaves nothing playing, so every replay starts from the same state.
+static void settle() {
+    press_key('s');
+    run_ms(100);
+    TEST_ASSERT_FALSE(event_trace.is_replaying());
+}
+
+static void replay_fast(uint32_t* events, uint32_t* signature) {
+    press_key('f');
+    TEST_ASSERT_TRUE(event_trace.is_replaying());
+    for (uint32_t ms = 0; ms < 10000 && event_trace.is_replaying(); ms++) {
+        loop();
+    }
+    TEST_ASSERT_FALSE(event_trace.is_replaying());
+    *events = event_trace.events();
+    *signature = event_trace.signature();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_fast_replays_reproduce_the_recording() {
+    write_fixtures();
+    setup();
+    run_ms(100);
+
+    press_key('t');
+    TEST_ASSERT_TRUE(event_trace.is_recording());
+    for (uint32_t ms = 0; ms < SESSION_MS; ms++) {
+        drive_session(ms);
+        loop();
+    }
+    press_key('t');
+    TEST_ASSERT_FALSE(event_trace.is_recording());
+    TEST_ASSERT_TRUE(event_trace.recording_complete());
+    uint32_t recorded_events = event_trace.events();
+    uint32_t recorded_signature = event_trace.signature();
+    // 4 taps and 4 removals, 9 turns, 3 presses, 5 keys and the end of c.mp3.
+    TEST_ASSERT_EQUAL_UINT32(4 + 4 + 9 + 2 * 3 + 5 + 1, recorded_events);
+
+    uint32_t events[2];
+    uint32_t signatures[2];
+    for (int run = 0; run < 2; run++) {
+        settle();
+        replay_fast(&events[run], &signatures[run]);
+        TEST_ASSERT_EQUAL_UINT32(recorded_events, events[run]);
+        TEST_ASSERT_EQUAL_UINT32(recorded_signature, signatures[run]);
+    }
+
+    // Live input during a replay is dropped, not mixed in.
+    settle();
+    press_key('f');
+    host::serial_input += "+";
+    put_card(CARD_TRACK_B, sizeof(CARD_TRACK_B));
+    for (uint32_t ms = 0; ms < 10000 && event_trace.is_replaying(); ms++) {
+        loop();
+    }
+    lift_card();
+    TEST_ASSERT_EQUAL_UINT32(recorded_events, event_trace.events());
+    TEST_ASSERT_EQUAL_UINT32(recorded_signature, event_trace.signature());
+
+    // A card that fills up mid-recording is reported, not passed off as a trace.
+    settle();
+    run_ms(2000);
+    host::fs_free_bytes = 16;
+    press_key('t');
+    TEST_ASSERT_TRUE(event_trace.is_recording());
+    for (uint32_t ms = 0; ms < 5000; ms++) {
+        drive_session(ms);
+        loop();
+    }
+    press_key('t');
+    host::fs_free_bytes = UINT64_MAX;
+    TEST_ASSERT_FALSE(event_trace.is_recording());
+    TEST_ASSERT_FALSE(event_trace.recording_complete());
+
+    remove_fixtures();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fast_replays_reproduce_the_recording);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+// NDEF TLV scanning and record parsing against well-formed and crafted data.
+
+#include "ndef.h"
+#include <string.h>
+#include <unity.h>
+
+// Builds a short well-known record: header, type length, payload length, type.
+static size_t short_record(uint8_t* out, char type, const uint8_t* payload, uint8_t payload_length) {
+    out[0] = 0xD1; // MB, ME, SR, TNF well-known
+    out[1] = 1;
+    out[2] = payload_length;
+    out[3] = type;
+    memcpy(out + 4, payload, payload_length);
+    return 4 + payload_length;
+}
+
+static PathString parse(const uint8_t* message, size_t length) {
+    return parse_ndef_path(message, length);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_text_record_skips_language_code() {
+    const uint8_t payload[] = {0x02, 'e', 'n', 'a', '/', 'b', '.', 'm', 'p', '3'};
+    uint8_t message[32];
+    size_t length = short_record(message, 'T', payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("a/b.mp3", parse(message, length).c_str());
+}
+
+void test_text_record_trims_whitespace() {
+    const uint8_t payload[] = {0x00, ' ', 'x', '.', 'm', 'p', '3', '\n'};
+    uint8_t message[32];
+    size_t length = short_record(message, 'T', payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("x.mp3", parse(message, length).c_str());
+}
+
+void test_utf16_text_is_rejected() {
+    const uint8_t payload[] = {0x82, 'e', 'n', 'x', 0};
+    uint8_t message[32];
+    size_t length = short_record(message, 'T', payload, sizeof(payload));
+    TEST_ASSERT_TRUE(parse(message, length).empty());
+}
+
+void test_uri_record_without_prefix() {
+    const uint8_t payload[] = {0x00, 'c', '.', 'm', 'p', '3'};
+    uint8_t message[32];
+    size_t length = short_record(message, 'U', payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("c.mp3", parse(message, length).c_str());
+}
+
+void test_file_uri_record() {
+    const uint8_t payload[] = {0x1D, 'd', '/', 'e', '.', 'm', 'p', '3'};
+    uint8_t message[32];
+    size_t length = short_record(message, 'U', payload, sizeof(payload));
+    TEST_ASSERT_EQUAL_STRING("d/e.mp3", parse(message, length).c_str());
+}
+
+void test_web_uri_is_not_a_track() {
+    const uint8_t payload[] = {0x04, 'e', 'x', '.', 'c', 'o', 'm'}; // "https://"
+    uint8_t message[32];
+    size_t length = short_record(message, 'U', payload, sizeof(payload));
+    TEST_ASSERT_TRUE(parse(message, length).empty());
+}
+
+void test_record_with_id_field() {
+    const uint8_t message[] = {0xD9, 1, 3, 2, 'U', 'i', 'd', 0x00, 'f', '3'}; // IL set, 2-byte id
+    TEST_ASSERT_EQUAL_STRING("f3", parse(message, sizeof(message)).c_str());
+}
+
+void test_long_record() {
+    const uint8_t message[] = {0xC1, 1, 0, 0, 0, 3, 'U', 0x00, 'g', 'h'};
+    TEST_ASSERT_EQUAL_STRING("gh", parse(message, sizeof(message)).c_str());
+}
+
+void test_other_type_or_tnf_is_ignored() {
+    const uint8_t smart_poster[] = {0xD1, 2, 1, 'S', 'p', 0x00};
+    TEST_ASSERT_TRUE(parse(smart_poster, sizeof(smart_poster)).empty());
+    const uint8_t mime[] = {0xD2, 1, 2, 'x', 0x00, 'a'};
+    TEST_ASSERT_TRUE(parse(mime, sizeof(mime)).empty());
+}
+
+void test_payload_past_the_message_is_rejected() {
+    const uint8_t message[] = {0xD1, 1, 10, 'U', 0x00, 'a', 'b'};
+    TEST_ASSERT_TRUE(parse(message, sizeof(message)).empty());
+}
+
+// Lengths near 2^32 wrapped the old bounds sum on the 32-bit device.
+void test_huge_long_record_length_is_rejected() {
+    const uint8_t near_wrap[] = {0xC1, 1, 0xFF, 0xFF, 0xFF, 0xFA, 'T', 0x00, 'a', 'b', 'c'};
+    TEST_ASSERT_TRUE(parse(near_wrap, sizeof(near_wrap)).empty());
+    const uint8_t max[] = {0xC1, 1, 0xFF, 0xFF, 0xFF, 0xFF, 'U', 0x00, 'a'};
+    TEST_ASSERT_TRUE(parse(max, sizeof(max)).empty());
+}
+
+void test_truncated_headers_are_rejected() {
+    const uint8_t empty_payload[] = {0xD1, 1, 0, 'U'};
+    TEST_ASSERT_TRUE(parse(empty_payload, sizeof(empty_payload)).empty());
+    const uint8_t cut_long_length[] = {0xC1, 1, 0, 0};
+    TEST_ASSERT_TRUE(parse(cut_long_length, sizeof(cut_long_length)).empty());
+    const uint8_t cut_id_length[] = {0xD9, 1, 1};
+    TEST_ASSERT_TRUE(parse(cut_id_length, sizeof(cut_id_length)).empty());
+    const uint8_t id_past_end[] = {0xD9, 1, 1, 200, 'U', 0x00};
+    TEST_ASSERT_TRUE(parse(id_past_end, sizeof(id_past_end)).empty());
+    const uint8_t language_past_payload[] = {0xD1, 1, 2, 'T', 0x05, 'e'};
+    TEST_ASSERT_TRUE(parse(language_past_payload, sizeof(language_past_payload)).empty());
+    TEST_ASSERT_TRUE(parse(empty_payload, 2).empty());
+}
+
+void test_overlong_path_is_truncated_not_overrun() {
+    uint8_t payload[255];
+    payload[0] = 0x00;
+    memset(payload + 1, 'a', sizeof(payload) - 1);
+    uint8_t message[4 + sizeof(payload)];
+    size_t length = short_record(message, 'U', payload, sizeof(payload));
+    PathString path = parse(message, length);
+    TEST_ASSERT_TRUE(path.truncated());
+    TEST_ASSERT_EQUAL_UINT32(PathString::capacity(), path.length());
+}
+
+void test_finds_message_after_other_tlvs() {
+    // NULL, Lock Control (3 bytes), then the message.
+    const uint8_t data[] = {0x00, 0x01, 0x03, 0xA0, 0x0C, 0x34, 0x03, 0x05, 0xD1, 1, 1, 'U', 0x00, 0xFE};
+    size_t offset = 0;
+    size_t length = 0;
+    TEST_ASSERT_EQUAL_INT(NDEF_FOUND, find_ndef_message(data, sizeof(data), &offset, &length));
+    TEST_ASSERT_EQUAL_UINT32(8, offset);
+    TEST_ASSERT_EQUAL_UINT32(5, length);
+}
+
+void test_three_byte_tlv_length() {
+    uint8_t data[0x120] = {0x03, 0xFF, 0x01, 0x10};
+    size_t offset = 0;
+    size_t length = 0;
+    TEST_ASSERT_EQUAL_INT(NDEF_NEED_MORE, find_ndef_message(data, 0x100, &offset, &length));
+    TEST_ASSERT_EQUAL_INT(NDEF_FOUND, find_ndef_message(data, sizeof(data), &offset, &length));
+    TEST_ASSERT_EQUAL_UINT32(4, offset);
+    TEST_ASSERT_EQUAL_UINT32(0x110, length);
+}
+
+void test_scan_asks_for_more_until_the_message_is_complete() {
+    const uint8_t data[] = {0x03, 0x20, 0xD1};
+    size_t offset = 0;
+    size_t length = 0;
+    TEST_ASSERT_EQUAL_INT(NDEF_NEED_MORE, find_ndef_message(data, 1, &offset, &length));
+    TEST_ASSERT_EQUAL_INT(NDEF_NEED_MORE, find_ndef_message(data, sizeof(data), &offset, &length));
+    const uint8_t cut_long[] = {0x03, 0xFF, 0x01};
+    TEST_ASSERT_EQUAL_INT(NDEF_NEED_MORE, find_ndef_message(cut_long, sizeof(cut_long), &offset, &length));
+}
+
+void test_terminator_means_no_message() {
+    const uint8_t data[] = {0x00, 0xFE, 0x03, 0x01, 0x00};
+    size_t offset = 0;
+    size_t length = 0;
+    TEST_ASSERT_EQUAL_INT(NDEF_ABSENT, find_ndef_message(data, sizeof(data), &offset, &length));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_text_record_skips_language_code);
+    RUN_TEST(test_text_record_trims_whitespace);
+    RUN_TEST(test_utf16_text_is_rejected);
+    RUN_TEST(test_uri_record_without_prefix);
+    RUN_TEST(test_file_uri_record);
+    RUN_TEST(test_web_uri_is_not_a_track);
+    RUN_TEST(test_record_with_id_field);
+    RUN_TEST(test_long_record);
+    RUN_TEST(test_other_type_or_tnf_is_ignored);
+    RUN_TEST(test_payload_past_the_message_is_rejected);
+    RUN_TEST(test_huge_long_record_length_is_rejected);
+    RUN_TEST(test_truncated_headers_are_rejected);
+    RUN_TEST(test_overlong_path_is_truncated_not_overrun);
+    RUN_TEST(test_finds_message_after_other_tlvs);
+    RUN_TEST(test_three_byte_tlv_length);
+    RUN_TEST(test_scan_asks_for_more_until_the_message_is_complete);
+    RUN_TEST(test_terminator_means_no_message);
+    return UNITY_END();
+}
@@ -0,0 +1,90 @@
+// RotaryDecoder against FakeGpio, wired and timed the way InputHandler uses it.
+
+#include "board.h"
+#include "rotary_decoder.h"
+#include <unity.h>
+
+static const uint32_t DEBOUNCE = Board::ms_to_cycles(5);
+
+typedef RotaryDecoder<Board::EncoderClk, Board::EncoderDt, DEBOUNCE> Decoder;
+
+// What the ISR sees on a CLK edge: the input bank snapshot and the cycle count.
+static int edge(Decoder& decoder, bool clk, bool dt, uint32_t cycles) {
+    FakeGpio::set<Board::EncoderClk>(clk);
+    FakeGpio::set<Board::EncoderDt>(dt);
+    FakeGpio::cycle_count = cycles;
+    return decoder.on_edge(Board::Gpio::input(Board::EncoderClk::bank), Board::Gpio::cycles());
+}
+
+void setUp() {
+    FakeGpio::banks[0] = FakeGpio::banks[1] = 0xFFFFFFFF;
+    FakeGpio::cycle_count = 0;
+}
+
+void tearDown() {}
+
+void test_direction_follows_dt_on_falling_clk() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 1000));
+    TEST_ASSERT_EQUAL_INT(-1, edge(decoder, false, false, 1000 + DEBOUNCE));
+}
+
+void test_rising_clk_is_not_a_step() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, true, true, 1000));
+    // ...and does not open a debounce window either.
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 1001));
+}
+
+void test_first_edge_counts_at_cycle_zero() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(-1, edge(decoder, false, false, 0));
+}
+
+void test_edges_inside_debounce_window_are_dropped() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 5000));
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, true, 5001));
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, false, 5000 + DEBOUNCE - 1));
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 5000 + DEBOUNCE));
+}
+
+void test_bounce_does_not_extend_the_window() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 0));
+    for (uint32_t t = 1000; t < DEBOUNCE; t += 1000) {
+        TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, true, t));
+    }
+    // Measured from the accepted edge, not the last bounce.
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, DEBOUNCE));
+}
+
+void test_debounce_holds_across_cycle_counter_wrap() {
+    Decoder decoder;
+    uint32_t before_wrap = 0xFFFFFFFF - 100;
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, before_wrap));
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, true, 50));
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, true, before_wrap + DEBOUNCE - 1));
+    TEST_ASSERT_EQUAL_INT(-1, edge(decoder, false, false, before_wrap + DEBOUNCE));
+}
+
+// After a full counter period (~18 s) of no edges, one landing within the
+// debounce window of the aliased timestamp is dropped; the next one counts.
+void test_idle_for_a_full_wrap_drops_at_most_one_detent() {
+    Decoder decoder;
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 1000));
+    TEST_ASSERT_EQUAL_INT(0, edge(decoder, false, true, 1000 + 10)); // 2^32 + 10 cycles later
+    TEST_ASSERT_EQUAL_INT(1, edge(decoder, false, true, 1000 + DEBOUNCE));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_direction_follows_dt_on_falling_clk);
+    RUN_TEST(test_rising_clk_is_not_a_step);
+    RUN_TEST(test_first_edge_counts_at_cycle_zero);
+    RUN_TEST(test_edges_inside_debounce_window_are_dropped);
+    RUN_TEST(test_bounce_does_not_extend_the_window);
+    RUN_TEST(test_debounce_holds_across_cycle_counter_wrap);
+    RUN_TEST(test_idle_for_a_full_wrap_drops_at_most_one_detent);
+    return UNITY_END();
+}
@@ -0,0 +1,226 @@
+// SeekIndexBuilder over synthetic MP3 streams on DirStorage: frame parsing for
+// each MPEG version, the index offsets and durations, coarsening past four
+// hours, and the sidecar round trip.
+
+#include "seek_index.h"
+#include "storage_dir.h"
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+static std::string root;
+static DirStorage* storage;
+
+struct Stream {
+    uint8_t version_bits; // 3: MPEG1, 2: MPEG2, 0: MPEG2.5
+    uint8_t bitrate_index;
+    uint8_t rate_index;
+    uint32_t length;      // of an unpadded frame
+    uint32_t sample_rate;
+    uint32_t samples;     // per frame
+};
+
+// MPEG1 128 kbit/s 44.1 kHz, MPEG2 64 kbit/s 22.05 kHz, MPEG2.5 8 kbit/s 8 kHz.
+static const Stream MPEG1 = {3, 9, 0, 417, 44100, 1152};
+static const Stream MPEG2 = {2, 8, 0, 208, 22050, 576};
+static const Stream MPEG25 = {0, 1, 2, 72, 8000, 576};
+
+// Frame i starts at offset_of(i); odd frames carry the padding byte when
+// `padded`, so the stream also checks that the padding bit is honoured.
+static uint32_t offset_of(const Stream& s, uint32_t frame, bool padded, uint32_t start) {
+    return start + frame * s.length + (padded ? frame / 2 : 0);
+}
+
+static std::string frames(const Stream& s, uint32_t count, bool padded) {
+    std::string data;
+    data.reserve(count * (s.length + 1));
+    for (uint32_t i = 0; i < count; i++) {
+        bool pad = padded && (i & 1);
+        std::string frame(s.length + pad, '\0');
+        frame[0] = (char)0xFF;
+        frame[1] = (char)(0xE0 | (s.version_bits << 3) | (1 << 1) | 1); // layer III, no CRC
+        frame[2] = (char)((s.bitrate_index << 4) | (s.rate_index << 2) | (pad << 1));
+        data += frame;
+    }
+    return data;
+}
+
+static void write_file(const char* path, const std::string& data) {
+    std::string full = root + path;
+    FILE* f = fopen(full.c_str(), "wb");
+    TEST_ASSERT_TRUE(f != nullptr);
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+}
+
+static void build(const char* path) {
+    SeekIndexBuilder builder;
+    TEST_ASSERT_TRUE(builder.begin(*storage, path));
+    while (!builder.step(64 * 1024)) {
+    }
+    TEST_ASSERT_FALSE(builder.is_active());
+}
+
+// First frame at or after `seconds`, by counting samples.
+static uint32_t first_frame_at(const Stream& s, uint64_t seconds) {
+    uint64_t samples = seconds * s.sample_rate;
+    return (samples + s.samples - 1) / s.samples;
+}
+
+void setUp() {
+    char dir[] = "/tmp/talepod-index-XXXXXX";
+    TEST_ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    root = dir;
+    storage = new DirStorage(root);
+}
+
+void tearDown() {
+    delete storage;
+    std::string command = "rm -rf " + root;
+    TEST_ASSERT_EQUAL(0, system(command.c_str()));
+}
+
+static void check_stream(const Stream& s, bool padded) {
+    uint32_t count = first_frame_at(s, 60);
+    write_file("/t.mp3", frames(s, count, padded));
+    build("/t.mp3");
+
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/t.mp3"));
+    TEST_ASSERT_EQUAL_UINT32(60, index.duration());
+    for (uint32_t t = 0; t < 60; t += SeekIndex::DEFAULT_INTERVAL) {
+        TEST_ASSERT_EQUAL_UINT32(offset_of(s, first_frame_at(s, t), padded, 0), index.offset_for(t));
+    }
+    // Between entries, the one before; past the end, the last.
+    TEST_ASSERT_EQUAL_UINT32(index.offset_for(25), index.offset_for(29));
+    TEST_ASSERT_EQUAL_UINT32(index.offset_for(55), index.offset_for(3600));
+}
+
+void test_mpeg1_frames_with_padding() {
+    check_stream(MPEG1, true);
+}
+
+void test_mpeg2_half_rate_frames() {
+    check_stream(MPEG2, true);
+}
+
+void test_mpeg25_quarter_rate_frames() {
+    check_stream(MPEG25, false);
+}
+
+void test_seconds_at_maps_offsets_back_to_entries() {
+    write_file("/t.mp3", frames(MPEG1, first_frame_at(MPEG1, 60), true));
+    build("/t.mp3");
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/t.mp3"));
+
+    TEST_ASSERT_EQUAL_UINT32(0, index.seconds_at(0));
+    TEST_ASSERT_EQUAL_UINT32(30, index.seconds_at(index.offset_for(30)));
+    TEST_ASSERT_EQUAL_UINT32(25, index.seconds_at(index.offset_for(30) - 1));
+    TEST_ASSERT_EQUAL_UINT32(55, index.seconds_at(0xFFFFFFFF));
+}
+
+// An ID3v2 tag is skipped; garbage between frames and a trailing ID3v1 tag
+// are resynchronised over without adding entries or time.
+void test_tags_and_garbage_are_skipped() {
+    std::string tag = "ID3";
+    tag += std::string("\x04\x00\x00\x00\x00\x02\x00", 7); // 256 bytes of tag body
+    tag += std::string(256, 'x');
+    uint32_t half = first_frame_at(MPEG1, 20);
+    std::string junk(100, '\x00');
+    std::string data = tag + frames(MPEG1, half, false) + junk + frames(MPEG1, half, false) + "TAG" +
+                       std::string(125, ' ');
+    write_file("/t.mp3", data);
+    build("/t.mp3");
+
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/t.mp3"));
+    TEST_ASSERT_EQUAL_UINT32(tag.size(), index.offset_for(0));
+    TEST_ASSERT_EQUAL_UINT32(40, index.duration());
+    uint32_t second_half = tag.size() + half * MPEG1.length + junk.size();
+    uint32_t frame = first_frame_at(MPEG1, 25) - half;
+    TEST_ASSERT_EQUAL_UINT32(second_half + frame * MPEG1.length, index.offset_for(25));
+}
+
+// 4.5 h at 8 kbit/s: past MAX_ENTRIES at 5 s, so the index halves itself into
+// 10 s entries partway through and keeps going.
+void test_tracks_over_four_hours_coarsen() {
+    const uint32_t seconds = 16200;
+    write_file("/long.mp3", frames(MPEG25, first_frame_at(MPEG25, seconds), false));
+    build("/long.mp3");
+
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/long.mp3"));
+    TEST_ASSERT_EQUAL_UINT32(seconds, index.duration());
+    const uint32_t checks[] = {0, 10, 100, 7200, 14390, 14400, 14410, 16190};
+    for (uint32_t t : checks) {
+        TEST_ASSERT_EQUAL_UINT32(offset_of(MPEG25, first_frame_at(MPEG25, t), false, 0), index.offset_for(t));
+    }
+    TEST_ASSERT_EQUAL_UINT32(index.offset_for(100), index.offset_for(105));
+    TEST_ASSERT_EQUAL_UINT32(14400, index.seconds_at(index.offset_for(14400) + 1));
+}
+
+void test_four_hours_exactly_keeps_the_fine_interval() {
+    const uint32_t seconds = 14400;
+    write_file("/t.mp3", frames(MPEG25, first_frame_at(MPEG25, seconds), false));
+    build("/t.mp3");
+
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/t.mp3"));
+    TEST_ASSERT_EQUAL_UINT32(seconds, index.duration());
+    TEST_ASSERT_EQUAL_UINT32(offset_of(MPEG25, first_frame_at(MPEG25, 14395), false, 0), index.offset_for(14395));
+}
+
+void test_sidecar_round_trips_and_goes_stale() {
+    std::string data = frames(MPEG2, first_frame_at(MPEG2, 30), true);
+    write_file("/t.mp3", data);
+    build("/t.mp3");
+    TEST_ASSERT_TRUE(storage->exists("/t.mp3.idx", STORAGE_INDEX));
+
+    SeekIndex index;
+    TEST_ASSERT_TRUE(index.load(*storage, "/t.mp3", data.size()));
+    TEST_ASSERT_TRUE(index.is_loaded());
+    TEST_ASSERT_EQUAL_UINT32(30, index.duration());
+    uint32_t offset = index.offset_for(20);
+
+    // Written back and read again: the same table.
+    TEST_ASSERT_TRUE(index.save(*storage, "/copy.mp3"));
+    write_file("/copy.mp3", data);
+    SeekIndex copy;
+    TEST_ASSERT_TRUE(copy.load(*storage, "/copy.mp3"));
+    TEST_ASSERT_EQUAL_UINT32(offset, copy.offset_for(20));
+    TEST_ASSERT_EQUAL_UINT32(30, copy.duration());
+
+    // A replaced track (different size) no longer matches its sidecar.
+    write_file("/t.mp3", data + frames(MPEG2, 10, false));
+    TEST_ASSERT_FALSE(index.load(*storage, "/t.mp3"));
+    TEST_ASSERT_FALSE(index.is_loaded());
+    TEST_ASSERT_EQUAL_UINT32(0, index.offset_for(20));
+
+    // Nor does a damaged one.
+    write_file("/copy.mp3.idx", "TPSI");
+    TEST_ASSERT_FALSE(copy.load(*storage, "/copy.mp3"));
+}
+
+void test_missing_track_or_sidecar() {
+    SeekIndex index;
+    TEST_ASSERT_FALSE(index.load(*storage, "/none.mp3"));
+    write_file("/t.mp3", frames(MPEG1, 10, false));
+    TEST_ASSERT_FALSE(index.load(*storage, "/t.mp3"));
+    SeekIndexBuilder builder;
+    TEST_ASSERT_FALSE(builder.begin(*storage, "/none.mp3"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_mpeg1_frames_with_padding);
+    RUN_TEST(test_mpeg2_half_rate_frames);
+    RUN_TEST(test_mpeg25_quarter_rate_frames);
+    RUN_TEST(test_seconds_at_maps_offsets_back_to_entries);
+    RUN_TEST(test_tags_and_garbage_are_skipped);
+    RUN_TEST(test_tracks_over_four_hours_coarsen);
+    RUN_TEST(test_four_hours_exactly_keeps_the_fine_interval);
+    RUN_TEST(test_sidecar_round_trips_and_goes_stale);
+    RUN_TEST(test_missing_track_or_sidecar);
+    return UNITY_END();
+}
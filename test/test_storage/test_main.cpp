@@ -0,0 +1,294 @@
+// StorageFile over DirStorage: the read-ahead window, the bypass for large
+// aligned reads, seeking, the pooled buffers, buffered writes that fail and
+// stay failed, and the per-consumer accounting.
+
+#include "storage_dir.h"
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+struct BackendRead {
+    uint32_t offset;
+    size_t length;
+};
+
+// Records the reads that reach the directory, and fills up after
+// `space` written bytes like a full card.
+class RecordingStorage : public DirStorage {
+public:
+    std::vector<BackendRead> reads;
+    size_t space;
+
+    explicit RecordingStorage(const std::string& root) : DirStorage(root), space(SIZE_MAX) {}
+
+protected:
+    size_t backend_read(int handle, uint32_t offset, void* dst, size_t length) override {
+        reads.push_back({offset, length});
+        return DirStorage::backend_read(handle, offset, dst, length);
+    }
+
+    size_t backend_write(int handle, const void* src, size_t length) override {
+        size_t n = length < space ? length : space;
+        space -= n;
+        return DirStorage::backend_write(handle, src, n);
+    }
+};
+
+static const uint32_t FILE_SIZE = 64 * 1024;
+
+static std::string root;
+static RecordingStorage* storage;
+
+static uint8_t byte_at(uint32_t offset) {
+    return (uint8_t)(offset * 7 + (offset >> 8));
+}
+
+static void check_bytes(const uint8_t* data, uint32_t offset, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        TEST_ASSERT_EQUAL_UINT8(byte_at(offset + i), data[i]);
+    }
+}
+
+static std::string file_contents(const char* path) {
+    std::string data;
+    FILE* f = fopen((root + path).c_str(), "rb");
+    TEST_ASSERT_TRUE(f != nullptr);
+    char chunk[1024];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.append(chunk, n);
+    }
+    fclose(f);
+    return data;
+}
+
+void setUp() {
+    char dir[] = "/tmp/talepod-storage-XXXXXX";
+    TEST_ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    root = dir;
+    storage = new RecordingStorage(root);
+
+    FILE* f = fopen((root + "/data.bin").c_str(), "wb");
+    TEST_ASSERT_TRUE(f != nullptr);
+    for (uint32_t i = 0; i < FILE_SIZE; i++) {
+        fputc(byte_at(i), f);
+    }
+    fclose(f);
+}
+
+void tearDown() {
+    delete storage;
+    std::string command = "rm -rf " + root;
+    TEST_ASSERT_EQUAL(0, system(command.c_str()));
+}
+
+void test_window_doubles_while_reading_forward() {
+    StorageFile file = storage->open("/data.bin", STORAGE_AUDIO);
+    TEST_ASSERT_TRUE((bool)file);
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE, file.size());
+
+    uint8_t chunk[100];
+    for (uint32_t offset = 0; offset < 16 * 1024; offset += sizeof(chunk)) {
+        TEST_ASSERT_EQUAL_UINT32(sizeof(chunk), file.read(chunk, sizeof(chunk)));
+        check_bytes(chunk, offset, sizeof(chunk));
+    }
+
+    const BackendRead expected[] = {{0, 1024}, {1024, 2048}, {3072, 4096}, {7168, 4096}, {11264, 4096}, {15360, 4096}};
+    TEST_ASSERT_EQUAL_UINT32(6, storage->reads.size());
+    for (size_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].offset, storage->reads[i].offset);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].length, storage->reads[i].length);
+    }
+}
+
+void test_jump_drops_the_window_back() {
+    StorageFile file = storage->open("/data.bin", STORAGE_AUDIO);
+    uint8_t chunk[600];
+    for (int i = 0; i < 8; i++) {
+        file.read(chunk, sizeof(chunk));
+    }
+    storage->reads.clear();
+
+    TEST_ASSERT_TRUE(file.seek(40000));
+    TEST_ASSERT_EQUAL_UINT32(40000, file.position());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(chunk), file.read(chunk, sizeof(chunk)));
+    check_bytes(chunk, 40000, sizeof(chunk));
+    TEST_ASSERT_EQUAL_UINT32(1, storage->reads.size());
+    TEST_ASSERT_EQUAL_UINT32(40000 & ~(Storage::SECTOR_SIZE - 1), storage->reads[0].offset);
+    TEST_ASSERT_EQUAL_UINT32(Storage::MIN_WINDOW, storage->reads[0].length);
+
+    // Backwards too; the window ends at the file's end.
+    TEST_ASSERT_TRUE(file.seek(FILE_SIZE - 10));
+    TEST_ASSERT_EQUAL_UINT32(10, file.read(chunk, sizeof(chunk)));
+    check_bytes(chunk, FILE_SIZE - 10, 10);
+    TEST_ASSERT_EQUAL_UINT32(FILE_SIZE - Storage::SECTOR_SIZE, storage->reads[1].offset);
+    TEST_ASSERT_EQUAL_UINT32(Storage::SECTOR_SIZE, storage->reads[1].length);
+}
+
+void test_large_aligned_read_bypasses_the_buffer() {
+    StorageFile file = storage->open("/data.bin", STORAGE_AUDIO);
+    static uint8_t data[10000];
+    TEST_ASSERT_TRUE(file.seek(8192));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(data), file.read(data, sizeof(data)));
+    check_bytes(data, 8192, sizeof(data));
+
+    // Whole sectors straight in, then the rest through the buffer.
+    TEST_ASSERT_EQUAL_UINT32(2, storage->reads.size());
+    TEST_ASSERT_EQUAL_UINT32(8192, storage->reads[0].offset);
+    TEST_ASSERT_EQUAL_UINT32(9728, storage->reads[0].length);
+    TEST_ASSERT_EQUAL_UINT32(8192 + 9728, storage->reads[1].offset);
+
+    // Unaligned, it starts through the buffer and bypasses it from the
+    // first sector boundary the buffer ends on.
+    storage->reads.clear();
+    TEST_ASSERT_TRUE(file.seek(100));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(data), file.read(data, sizeof(data)));
+    check_bytes(data, 100, sizeof(data));
+    TEST_ASSERT_EQUAL_UINT32(0, storage->reads[0].offset);
+    TEST_ASSERT_EQUAL_UINT32(Storage::MIN_WINDOW, storage->reads[0].length);
+    TEST_ASSERT_EQUAL_UINT32(Storage::MIN_WINDOW, storage->reads[1].offset);
+    TEST_ASSERT_EQUAL_UINT32((sizeof(data) + 100 - Storage::MIN_WINDOW) & ~(Storage::SECTOR_SIZE - 1),
+                             storage->reads[1].length);
+}
+
+void test_seek_and_the_end_of_the_file() {
+    StorageFile file = storage->open("/data.bin", STORAGE_AUDIO);
+    TEST_ASSERT_FALSE(file.seek(FILE_SIZE + 1));
+    TEST_ASSERT_TRUE(file.seek(FILE_SIZE));
+    uint8_t b;
+    TEST_ASSERT_EQUAL_UINT32(0, file.read(&b, 1));
+    TEST_ASSERT_EQUAL_INT(-1, file.read());
+
+    TEST_ASSERT_TRUE(file.seek(300));
+    TEST_ASSERT_EQUAL_INT(byte_at(300), file.read());
+    TEST_ASSERT_EQUAL_INT(byte_at(301), file.read());
+    TEST_ASSERT_EQUAL_UINT32(302, file.position());
+
+    StorageFile missing = storage->open("/none.bin", STORAGE_AUDIO);
+    TEST_ASSERT_FALSE((bool)missing);
+    TEST_ASSERT_EQUAL_UINT32(0, missing.read(&b, 1));
+    TEST_ASSERT_FALSE(missing.seek(0));
+}
+
+// With every pool buffer taken, a file still works, one backend read per call.
+void test_files_past_the_pool_read_unbuffered() {
+    StorageFile held[Storage::POOL_BUFFERS];
+    for (int i = 0; i < Storage::POOL_BUFFERS; i++) {
+        held[i] = storage->open("/data.bin", STORAGE_AUDIO);
+    }
+    StorageFile file = storage->open("/data.bin", STORAGE_AUDIO);
+    storage->reads.clear();
+    uint8_t chunk[10];
+    TEST_ASSERT_TRUE(file.seek(123));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(chunk), file.read(chunk, sizeof(chunk)));
+    check_bytes(chunk, 123, sizeof(chunk));
+    TEST_ASSERT_EQUAL_UINT32(1, storage->reads.size());
+    TEST_ASSERT_EQUAL_UINT32(123, storage->reads[0].offset);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(chunk), storage->reads[0].length);
+
+    // Closing one hands its buffer to the next file.
+    held[0].close();
+    StorageFile buffered = storage->open("/data.bin", STORAGE_AUDIO);
+    storage->reads.clear();
+    buffered.read(chunk, sizeof(chunk));
+    TEST_ASSERT_EQUAL_UINT32(Storage::MIN_WINDOW, storage->reads[0].length);
+}
+
+void test_buffered_writes_reach_the_file_on_close() {
+    StorageFile file = storage->open("/out.bin", STORAGE_TRACE, true);
+    std::string data;
+    for (uint32_t i = 0; i < 10000; i++) {
+        data += (char)byte_at(i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3000, file.write(data.data(), 3000));
+    TEST_ASSERT_EQUAL_UINT32(7000, file.write(data.data() + 3000, 7000));
+    TEST_ASSERT_EQUAL_UINT32(10000, file.size());
+    TEST_ASSERT_FALSE(file.seek(0));
+    uint8_t b;
+    TEST_ASSERT_EQUAL_UINT32(0, file.read(&b, 1));
+    TEST_ASSERT_TRUE(file.close());
+    TEST_ASSERT_TRUE(file_contents("/out.bin") == data);
+}
+
+// Once the card fills, the short write is reported and every write after it
+// is refused, so a file never ends up with a gap in the middle.
+void test_failed_write_stays_failed() {
+    storage->space = 5000;
+    StorageFile file = storage->open("/out.bin", STORAGE_TRACE, true);
+    uint8_t data[3000];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = byte_at(i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3000, file.write(data, 3000)); // buffered
+    TEST_ASSERT_EQUAL_UINT32(3000, file.write(data, 3000)); // 4096 flushed
+    // The next flush gets 904 of its 4096 bytes out, all of them from the
+    // previous call, so none of this call's bytes made it.
+    TEST_ASSERT_EQUAL_UINT32(0, file.write(data, 3000));
+    TEST_ASSERT_EQUAL_UINT32(0, file.write(data, 10));
+    storage->space = SIZE_MAX;
+    TEST_ASSERT_EQUAL_UINT32(0, file.write(data, 10));
+    TEST_ASSERT_FALSE(file.close());
+    TEST_ASSERT_EQUAL_UINT32(5000, file_contents("/out.bin").size());
+
+    // A fresh file starts clean.
+    StorageFile again = storage->open("/out.bin", STORAGE_TRACE, true);
+    TEST_ASSERT_EQUAL_UINT32(10, again.write(data, 10));
+    TEST_ASSERT_TRUE(again.close());
+}
+
+// A flush that fails at close is reported by close().
+void test_short_final_flush_fails_close() {
+    storage->space = 100;
+    StorageFile file = storage->open("/out.bin", STORAGE_TRACE, true);
+    uint8_t data[200] = {};
+    TEST_ASSERT_EQUAL_UINT32(200, file.write(data, sizeof(data)));
+    TEST_ASSERT_FALSE(file.close());
+}
+
+void test_stats_are_kept_per_consumer() {
+    StorageStats artwork = Storage::stats(STORAGE_ARTWORK);
+    StorageStats index = Storage::stats(STORAGE_INDEX);
+    StorageStats audio = Storage::stats(STORAGE_AUDIO);
+
+    StorageFile file = storage->open("/data.bin", STORAGE_ARTWORK);
+    uint8_t chunk[2000];
+    file.read(chunk, sizeof(chunk)); // two backend reads, 1024 + 2048 bytes
+    TEST_ASSERT_TRUE(storage->exists("/data.bin", STORAGE_ARTWORK));
+    file.close();
+
+    StorageFile out = storage->open("/out.bin", STORAGE_INDEX, true);
+    out.write(chunk, 100);
+    out.close();
+
+    StorageStats a = Storage::stats(STORAGE_ARTWORK);
+    TEST_ASSERT_EQUAL_UINT32(artwork.calls + 4, a.calls); // open, 2 reads, exists
+    TEST_ASSERT_EQUAL_UINT32(artwork.bytes + 3072, a.bytes);
+    StorageStats i = Storage::stats(STORAGE_INDEX);
+    TEST_ASSERT_EQUAL_UINT32(index.calls + 2, i.calls); // open, the write at close
+    TEST_ASSERT_EQUAL_UINT32(index.bytes + 100, i.bytes);
+    StorageStats u = Storage::stats(STORAGE_AUDIO);
+    TEST_ASSERT_EQUAL_UINT32(audio.calls, u.calls);
+    TEST_ASSERT_EQUAL_UINT32(audio.bytes, u.bytes);
+
+    // I/O done outside the layer is added in as reported.
+    Storage::account(STORAGE_AUDIO, 512, 1, 40);
+    u = Storage::stats(STORAGE_AUDIO);
+    TEST_ASSERT_EQUAL_UINT32(audio.bytes + 512, u.bytes);
+    TEST_ASSERT_EQUAL_UINT32(audio.busy_us + 40, u.busy_us);
+    TEST_ASSERT_EQUAL_STRING("artwork", Storage::consumer_name(STORAGE_ARTWORK));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_doubles_while_reading_forward);
+    RUN_TEST(test_jump_drops_the_window_back);
+    RUN_TEST(test_large_aligned_read_bypasses_the_buffer);
+    RUN_TEST(test_seek_and_the_end_of_the_file);
+    RUN_TEST(test_files_past_the_pool_read_unbuffered);
+    RUN_TEST(test_buffered_writes_reach_the_file_on_close);
+    RUN_TEST(test_failed_write_stays_failed);
+    RUN_TEST(test_short_final_flush_fails_close);
+    RUN_TEST(test_stats_are_kept_per_consumer);
+    return UNITY_END();
+}